@@ -1,5 +1,6 @@
 #include <Windows.h>
 #include "nodeProcessDevice.h"
+#include "../src/PointClusterer.h"
 
 using namespace rp::standalone::rplidar;
 
@@ -145,55 +146,6 @@ static float blobContains(const Blob& blob, float x, float y)
     return x >= blob.min_x && x <= blob.max_x && y >= blob.min_y && y <= blob.max_y;
 }
 
-static float blobDistance(const Blob& a, const Blob& b)
-{
-    if (blobContains(a, b.min_x, b.min_y))
-        return 0;
-    
-    if (blobContains(a, b.max_x, b.min_y))
-        return 0;
-    
-    if (blobContains(a, b.min_x, b.max_y))
-        return 0;
-    
-    if (blobContains(a, b.max_x, b.max_y))
-        return 0;
-    
-    float x_distance = a.max_x < b.min_x ? b.min_x - a.max_x : a.min_x - b.max_x;
-    float y_distance = a.max_y < b.min_y ? b.min_y - a.max_y : a.min_y - b.max_y;
-    
-    return sqrtf(x_distance*x_distance + y_distance*y_distance);
-}
-
-static int mergeBlobs(const std::list<Blob>& input, std::list<Blob>& output)
-{
-    int mergedBlobs = 0;
-    output.clear();
-    
-    for (auto iter = input.begin(); iter != input.end(); iter++)
-    {
-        auto& inputBlob = *iter;
-
-        bool merged = false;
-        
-        for (auto compareBlobIter = output.begin(); compareBlobIter != output.end(); compareBlobIter++)
-        {
-            auto& compareBlob = *compareBlobIter;
-            if (blobDistance(inputBlob, compareBlob) < BlobCombinationThreshold)
-            {
-                merged = true;
-                compareBlob.expand(inputBlob);
-                mergedBlobs++;
-            }
-        }
-        
-        if (!merged)
-            output.push_back(inputBlob);
-    }
-    
-    return mergedBlobs;
-}
-
 static void polar2cartesian(const LidarScanPoint& laserPoint, float& x, float& y)
 {
 	float rad = (laserPoint.angle + driver_config.angle_offset) * PI / 180.0f ;
@@ -212,8 +164,10 @@ static void physical2screen(float x, float y, int screenWidth, int screenHeight,
 
 static void lookupBlobs(const LidarScan& scan, std::list<Blob>& blobs)
 {
-    std::list<Blob> tmp;
+    static std::vector<Point2D> points;
+    static PointClusterer clusterer;
 
+    points.clear();
     for (auto laserPointIter = scan.begin(); laserPointIter != scan.end(); laserPointIter++)
     {
         auto& laserPoint = *laserPointIter;
@@ -227,21 +181,21 @@ static void lookupBlobs(const LidarScan& scan, std::list<Blob>& blobs)
         if (!blobContains(CropArea, x, y))
             continue;
         
-        tmp.push_back(Blob(x, y));
+        points.push_back(Point2D(x, y));
     }
-    
-#if 0
-    std::swap(tmp, blobs);
-#else
-    while (true)
+
+    // single linkage on the points, what the repeated bounding box merge converged to
+    blobs.clear();
+    clusterer.execute(points.data(), points.size(), BlobCombinationThreshold);
+    const auto& indices = clusterer.getIndices();
+    for (const auto& cluster : clusterer.getClusters())
     {
-        if (mergeBlobs(tmp, blobs) == 0)
-            return;
-        
-        std::swap(tmp, blobs);
+        blobs.push_back(Blob(cluster.minX, cluster.minY, cluster.maxX, cluster.maxY));
+        auto& blob = blobs.back();
+        blob.laserPoints.reserve(cluster.count);
+        for (uint32_t k = cluster.first; k < cluster.first + cluster.count; k++)
+            blob.laserPoints.push_back(points[indices[k]]);
     }
-#endif
-    
 }
 
 //-----------------------------------------
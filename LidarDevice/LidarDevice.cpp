@@ -1,10 +1,21 @@
 #include "LidarDevice.h"
-#include "cinder/Log.h"
+
+#include <algorithm>
 
 using namespace std;
 
-void LidarDevice::info_(const string &err)
+int LidarDevice::infoSite()
+{
+    static std::atomic<int> count{ 0 };
+    return count++;
+}
+
+void LidarDevice::info_(int site, const char *file, int line, const string &err)
 {
-    CI_LOG_I(err);
+    // the sites past the table share its last entry
+    asynclog::Site &s = infoSites[std::min(site, kMaxInfoSites - 1)];
+    s.file = file;
+    s.line = line;
+    asynclog::write(s, asynclog::LEVEL_INFO, "%s", err.c_str());
     status = err;
 }
@@ -1,18 +1,48 @@
 #pragma once
 
+#include <stdint.h>
 #include <string>
 #include <vector>
 
+#include "AsyncLog.h"
+
+// Sets status and logs message, rate limited per device and call site.
+#define LIDAR_INFO(message) do { \
+        static const int _lidarInfoSite = LidarDevice::infoSite(); \
+        info_(_lidarInfoSite, __FILE__, __LINE__, message); \
+    } while (0)
+
 struct LidarScanPoint
 {
     float dist;     // in millimeter
     float angle;    // in degree, 0 expected to be the front of LIDAR, and increase by rotate in counter-clockwise (left-hand system)
     bool valid;     // if the lidar scan point is valid or not (for eg. no obstacle detected)
+    uint8_t quality;    // signal strength reported by the device, 0 if unknown
+};
+
+// Scheduling of the thread inside the SDK that reads the serial port.
+struct LidarThreadOption
+{
+    int priority = 0;           // SCHED_FIFO priority 1-99, 0 for normal scheduling
+    bool roundRobin = false;    // SCHED_RR instead of SCHED_FIFO
+    uint64_t cpuMask = 0;       // 0 for all cpus
+    bool lockMemory = false;    // keep the scan buffers of the SDK in RAM
+};
+
+// Arrival of the measurement packets on the serial port since the last query.
+struct LidarPacketJitter
+{
+    uint32_t packets = 0;
+    float meanUs = 0;
+    float stddevUs = 0;
+    float maxUs = 0;
 };
 
 struct LidarDevice
 {
-    void info_(const std::string &err);
+    // Index of a LIDAR_INFO call site, the same for every device.
+    static int infoSite();
+    void info_(int site, const char *file, int line, const std::string &err);
 
     std::string status;
 
@@ -22,9 +52,20 @@ struct LidarDevice
     
     virtual bool isValid() = 0;
 
-    virtual void update() = 0;
+    // Returns true when scanData holds a new scan.
+    virtual bool update() = 0;
+
+    // Kept across setup() calls. Returns false when the system denied a setting.
+    virtual bool setThreadOption(const LidarThreadOption &) { return true; }
+
+    // Returns false when the device does not measure it.
+    virtual bool getPacketJitter(LidarPacketJitter &) { return false; }
 
     std::vector<LidarScanPoint> scanData;
+
+private:
+    static const int kMaxInfoSites = 32;
+    asynclog::Site infoSites[kMaxInfoSites];
 };
 
 
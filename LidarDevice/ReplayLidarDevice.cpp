@@ -0,0 +1,99 @@
+#include "ReplayLidarDevice.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+
+namespace
+{
+    const uint64_t kScanIntervalUs = 100000;
+
+    uint64_t nowUs()
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+}
+
+void ReplayLidarDevice::writeScan(std::ostream &out, const std::vector<LidarScanPoint> &scan)
+{
+    for (size_t i = 0; i < scan.size(); i++)
+    {
+        const LidarScanPoint &pt = scan[i];
+        if (i > 0) out << ' ';
+        out << pt.angle << ' ' << (pt.valid ? pt.dist : 0) << ' ' << (int)pt.quality;
+    }
+    out << '\n';
+}
+
+bool ReplayLidarDevice::setup(const std::string &serialPort)
+{
+    scans.clear();
+    next = 0;
+    nextUs = 0;
+
+    std::ifstream file(serialPort);
+    if (!file)
+    {
+        LIDAR_INFO("Fail to open replay file");
+        return false;
+    }
+
+    size_t maxSize = 0;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream values(line);
+        std::vector<LidarScanPoint> scan;
+        float angle, dist;
+        int quality;
+        while (values >> angle >> dist >> quality)
+        {
+            LidarScanPoint pt;
+            pt.angle = angle;
+            pt.dist = dist;
+            pt.valid = dist > 0;
+            pt.quality = (uint8_t)quality;
+            scan.push_back(pt);
+        }
+        if (scan.empty()) continue;
+        maxSize = std::max(maxSize, scan.size());
+        scans.push_back(std::move(scan));
+    }
+    if (scans.empty())
+    {
+        LIDAR_INFO("No scan in replay file");
+        return false;
+    }
+
+    // update() copies without allocating
+    scanData.reserve(maxSize);
+    LIDAR_INFO("Replaying " + std::to_string(scans.size()) + " scans");
+    return true;
+}
+
+bool ReplayLidarDevice::isValid()
+{
+    return !scans.empty();
+}
+
+bool ReplayLidarDevice::update()
+{
+    TRACE_SCOPE("ReplayLidarDevice::update");
+
+    if (!isValid())
+        return false;
+
+    uint64_t now = nowUs();
+    if (now < nextUs)
+        return false;
+    nextUs = nextUs == 0 || now - nextUs > kScanIntervalUs ? now + kScanIntervalUs : nextUs + kScanIntervalUs;
+
+    const auto &scan = scans[next];
+    scanData.assign(scan.begin(), scan.end());
+    next = (next + 1) % scans.size();
+    return true;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "LidarDevice.h"
+#include <stdint.h>
+#include <ostream>
+
+// Plays back scans from a text file instead of a serial port, so that the
+// pipeline runs without hardware, e.g. "file:scans.txt" in LIDAR_DEVICES.
+// One scan per line of "angle dist quality" triples, in degree and millimeter.
+// Lines starting with # are skipped, the scans loop at 10 Hz. Run the app
+// with --record-scans to record the devices in this format.
+struct ReplayLidarDevice : public LidarDevice
+{
+    // Appends scan as one line, invalid points with distance 0.
+    static void writeScan(std::ostream &out, const std::vector<LidarScanPoint> &scan);
+
+    virtual bool setup(const std::string &serialPort);
+    virtual bool isValid();
+    virtual bool update();
+
+    std::vector<std::vector<LidarScanPoint>> scans;
+    size_t next = 0;
+    uint64_t nextUs = 0;
+};
@@ -1,11 +1,9 @@
 #include "RpLidarDevice.h"
 #include "rplidar.h"
-#include "cinder/Log.h"
+#include "Trace.h"
 
 using namespace rp::standalone::rplidar;
 
-RPlidarDriver *drv = nullptr;
-
 bool RpLidarDevice::setup(const std::string &serialPort)
 {
     // create the driver instance
@@ -14,9 +12,10 @@ bool RpLidarDevice::setup(const std::string &serialPort)
         drv = RPlidarDriver::CreateDriver(DRIVER_TYPE_SERIALPORT);
         if (!drv)
         {
-            info_("insufficent memory, exit");
+            LIDAR_INFO("insufficent memory, exit");
             return false;
         }
+        setThreadOption(threadOption);
     }
 
     drv->disconnect();
@@ -24,11 +23,11 @@ bool RpLidarDevice::setup(const std::string &serialPort)
     // make connection...
     if (IS_FAIL(drv->connect(serialPort.c_str(), 115200)))
     {
-        info_("Fail to connect LIDAR");
+        LIDAR_INFO("Fail to connect LIDAR");
         return false;
     }
 
-    info_("Connected to RPLidar");
+    LIDAR_INFO("Connected to RPLidar");
 
     rplidar_response_device_info_t devinfo;
 
@@ -36,17 +35,17 @@ bool RpLidarDevice::setup(const std::string &serialPort)
     ////////////////////////////////////////
     if (IS_FAIL(drv->getDeviceInfo(devinfo)))
     {
-        info_("getDeviceInfo() fails");
+        LIDAR_INFO("getDeviceInfo() fails");
         return false;
     }
 
-    CI_LOG_I("Firmware Ver: " << (devinfo.firmware_version >> 8) << '.' << (devinfo.firmware_version & 0xFF));
-    CI_LOG_I("Hardware Rev: " << (int)devinfo.hardware_version);
+    ASYNC_LOG_I("Firmware Ver: %d.%d", devinfo.firmware_version >> 8, devinfo.firmware_version & 0xFF);
+    ASYNC_LOG_I("Hardware Rev: %d", (int)devinfo.hardware_version);
 
     // check health...
     if (!checkRPLIDARHealth())
     {
-        info_("checkRPLIDARHealth() fails");
+        LIDAR_INFO("checkRPLIDARHealth() fails");
         return false;
     }
 
@@ -56,12 +55,12 @@ bool RpLidarDevice::setup(const std::string &serialPort)
 
     if (IS_FAIL(drv->startMotor()))
     {
-        info_("startMotor() fails");
+        LIDAR_INFO("startMotor() fails");
     }
 
     if (IS_FAIL(drv->startScan(true, true)))
     {
-        info_("startScan() fails");
+        LIDAR_INFO("startScan() fails");
     }
 
     return true;
@@ -85,10 +84,10 @@ bool RpLidarDevice::checkRPLIDARHealth()
     op_result = drv->getHealth(healthinfo);
     if (IS_OK(op_result))
     { // the macro IS_OK is the preperred way to judge whether the operation is succeed.
-        printf("RPLidar health status : %d\n", healthinfo.status);
+        ASYNC_LOG_I("RPLidar health status : %d", healthinfo.status);
         if (healthinfo.status == RPLIDAR_STATUS_ERROR)
         {
-            fprintf(stderr, "Error, rplidar internal error detected. Please reboot the device to retry.\n");
+            ASYNC_LOG_E("Error, rplidar internal error detected. Please reboot the device to retry.");
             // enable the following code if you want rplidar to be reboot by software
             // drv->reset();
             return false;
@@ -100,34 +99,54 @@ bool RpLidarDevice::checkRPLIDARHealth()
     }
     else
     {
-        fprintf(stderr, "Error, cannot retrieve the lidar health code: %x\n", op_result);
+        ASYNC_LOG_E("Error, cannot retrieve the lidar health code: %x", op_result);
         return false;
     }
 }
 
+bool RpLidarDevice::setThreadOption(const LidarThreadOption &option)
+{
+    threadOption = option;
+    if (!drv) return true;
+    return IS_OK(drv->setCacheThreadScheduling(option.priority, option.roundRobin, option.cpuMask, option.lockMemory));
+}
+
+bool RpLidarDevice::getPacketJitter(LidarPacketJitter &jitter)
+{
+    RplidarPacketJitter packets;
+    if (!drv || IS_FAIL(drv->getPacketJitter(packets))) return false;
+    jitter.packets = packets.packet_count;
+    jitter.meanUs = packets.mean_us;
+    jitter.stddevUs = packets.stddev_us;
+    jitter.maxUs = packets.max_us;
+    return true;
+}
+
 bool RpLidarDevice::isValid()
 {
-    return drv->isConnected();
+    return drv && drv->isConnected();
 }
 
-void RpLidarDevice::update()
+bool RpLidarDevice::update()
 {
-    if (!drv->isConnected())
-        return;
+    TRACE_SCOPE("RpLidarDevice::update");
+
+    if (!isValid())
+        return false;
 
     const int SCAN_COUNT = 8192;
     rplidar_response_measurement_node_hq_t nodes[SCAN_COUNT];
     size_t scanCount = SCAN_COUNT;
     if (IS_FAIL(drv->grabScanDataHq(nodes, scanCount)))
     {
-        info_("grabScanData() fails");
-        return;
+        LIDAR_INFO("grabScanData() fails");
+        return false;
     }
 
     if (IS_FAIL(drv->ascendScanData(nodes, scanCount)))
     {
-        info_("ascendScanData() fails");
-        return;
+        LIDAR_INFO("ascendScanData() fails");
+        return false;
     }
 
     scanData.resize(scanCount);
@@ -136,5 +155,7 @@ void RpLidarDevice::update()
         scanData[pos].angle = nodes[pos].angle_z_q14 * 90.f / 16384.f;
         scanData[pos].dist = nodes[pos].dist_mm_q2 / 4.0f;
         scanData[pos].valid = (nodes[pos].dist_mm_q2 != 0);
+        scanData[pos].quality = nodes[pos].quality;
     }
+    return true;
 }
@@ -2,12 +2,21 @@
 
 #include "LidarDevice.h"
 
+namespace rp { namespace standalone { namespace rplidar {
+    class RPlidarDriver;
+} } }
+
 struct RpLidarDevice : public LidarDevice
 {
     virtual bool setup(const std::string &serialPort);
     virtual ~RpLidarDevice();
     virtual bool isValid();
-    virtual void update();
+    virtual bool update();
+    virtual bool setThreadOption(const LidarThreadOption &option);
+    virtual bool getPacketJitter(LidarPacketJitter &jitter);
 
     bool checkRPLIDARHealth();
+
+    rp::standalone::rplidar::RPlidarDriver *drv = nullptr;
+    LidarThreadOption threadOption;
 };
@@ -1,6 +1,8 @@
 #include "YdLidarDevice.h"
 #include "CYdLidar.h"
-#include "cinder/Log.h"
+#include "Trace.h"
+
+#include <algorithm>
 
 using namespace ydlidar;
 
@@ -9,33 +11,62 @@ using namespace ydlidar;
 #define IS_FAIL(x) ((x) == RESULT_FAIL)
 #endif
 
-CYdLidar drv;
+YdLidarDevice::YdLidarDevice() : scan(new LaserScan())
+{
+}
 
 bool YdLidarDevice::setup(const std::string &serialPort)
 {
     // create the driver instance
+    if (!drv)
+    {
+        drv.reset(new CYdLidar());
+    }
     const int baud = 115200;
     const int intensities = 0;
-    drv.setSerialPort(serialPort);
-    drv.setSerialBaudrate(baud);
-    drv.setIntensities(intensities);
-    drv.turnOff();
+    drv->setSerialPort(serialPort);
+    drv->setSerialBaudrate(baud);
+    drv->setIntensities(intensities);
+    drv->turnOff();
 
-    if (!drv.initialize())
+    if (!drv->initialize())
     {
-        info_("Failed to connect");
+        LIDAR_INFO("Failed to connect");
         return false;
     }
 
-    info_("Connected to Lidar");
+    LIDAR_INFO("Connected to Lidar");
     running = true;
     return true;
 }
 
 YdLidarDevice::~YdLidarDevice()
 {
-    drv.turnOff();
-    drv.disconnecting();
+    if (drv)
+    {
+        drv->turnOff();
+        drv->disconnecting();
+    }
+}
+
+bool YdLidarDevice::setThreadOption(const LidarThreadOption &option)
+{
+    if (!drv)
+    {
+        drv.reset(new CYdLidar());
+    }
+    return drv->setThreadScheduling(option.priority, option.roundRobin, option.cpuMask, option.lockMemory);
+}
+
+bool YdLidarDevice::getPacketJitter(LidarPacketJitter &jitter)
+{
+    package_jitter packages;
+    if (!drv || !drv->getPackageJitter(packages)) return false;
+    jitter.packets = packages.package_count;
+    jitter.meanUs = packages.mean_us;
+    jitter.stddevUs = packages.stddev_us;
+    jitter.maxUs = packages.max_us;
+    return true;
 }
 
 bool YdLidarDevice::isValid()
@@ -43,23 +74,23 @@ bool YdLidarDevice::isValid()
     return running;
 }
 
-void YdLidarDevice::update()
+bool YdLidarDevice::update()
 {
+    TRACE_SCOPE("YdLidarDevice::update");
+
     bool hardError;
-    LaserScan scan;
 
-    if (drv.doProcessSimple(scan, hardError))
+    if (running && drv->doProcessSimple(*scan, hardError))
     {
-        static char info[256];
-        sprintf(info, "Scan received: %u ranges", (unsigned int)scan.ranges.size());
-        //info_(info);
-
-        scanData.resize(scan.ranges.size());
-        for (int pos = 0; pos < scan.ranges.size(); ++pos)
+        scanData.resize(scan->ranges.size());
+        for (int pos = 0; pos < scan->ranges.size(); ++pos)
         {
-            scanData[pos].angle = scan.angles[pos];
-            scanData[pos].dist = scan.ranges[pos] * 1000;
-            scanData[pos].valid = (scan.intensities[pos] != 0);
+            scanData[pos].angle = scan->angles[pos];
+            scanData[pos].dist = scan->ranges[pos] * 1000;
+            scanData[pos].valid = (scan->intensities[pos] != 0);
+            scanData[pos].quality = (uint8_t)std::min(scan->intensities[pos], 255.0f);
         }
+        return true;
     }
+    return false;
 }
@@ -1,12 +1,22 @@
 #pragma once
 
 #include "LidarDevice.h"
+#include <memory>
+
+class CYdLidar;
+struct LaserScan;
 
 struct YdLidarDevice : public LidarDevice
 {
+    YdLidarDevice();
     virtual bool setup(const std::string &serialPort);
     virtual ~YdLidarDevice();
     virtual bool isValid();
-    virtual void update();
+    virtual bool update();
+    virtual bool setThreadOption(const LidarThreadOption &option);
+    virtual bool getPacketJitter(LidarPacketJitter &jitter);
     bool running = false;
+
+    std::unique_ptr<CYdLidar> drv;
+    std::unique_ptr<LaserScan> scan;    // reused so that update() does not allocate
 };
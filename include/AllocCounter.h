@@ -0,0 +1,64 @@
+#pragma once
+
+// Heap allocation counters per pipeline stage and per thread, to find
+// allocations that sneak into the hot path.
+//
+// Compiled in only when MINIAREASCAN_ALLOC_COUNTER is defined, e.g. by the
+// AllocCheck configuration. With glibc that build replaces malloc, free and
+// the aligned allocators, which sees every allocation of the process. The
+// Windows debug CRT reports the heap of the modules linked against it, but
+// not of the OpenCV DLL, and other Windows builds only replace operator new
+// / delete, so there the check misses the allocations inside OpenCV. It is
+// meant for testing the app, not for shipping. Without it ALLOC_STAGE
+// compiles to nothing.
+
+#if defined(MINIAREASCAN_ALLOC_COUNTER)
+
+#include <stdint.h>
+
+namespace alloc
+{
+    enum Stage
+    {
+        STAGE_NONE,
+        STAGE_ACQUISITION,  // device read and scan filtering
+        STAGE_DETECTION,    // fusion, rasterization and blob finding
+        STAGE_TRACKING,
+        STAGE_OUTPUT,       // TUIO, shared memory, library callback
+        STAGE_COUNT
+    };
+
+    struct Counts
+    {
+        uint64_t allocs;
+        uint64_t frees;
+        uint64_t bytes;     // requested by allocs
+    };
+
+    const char *getStageName(Stage stage);
+
+    // Totals of all threads while they were inside stage.
+    Counts getStageCounts(Stage stage);
+
+    // Totals of the calling thread.
+    Counts getThreadCounts();
+
+    // Tags the allocations of the calling thread until it goes out of scope.
+    struct Scope
+    {
+        Scope(Stage stage);
+        ~Scope();
+
+        Stage previous;
+    };
+}
+
+#define ALLOC_CONCAT_(a, b) a##b
+#define ALLOC_CONCAT(a, b) ALLOC_CONCAT_(a, b)
+#define ALLOC_STAGE(stage) alloc::Scope ALLOC_CONCAT(_allocScope, __LINE__)(alloc::stage)
+
+#else
+
+#define ALLOC_STAGE(stage)
+
+#endif
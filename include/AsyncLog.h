@@ -0,0 +1,71 @@
+#pragma once
+
+// Non-blocking log channel for threads that must not wait on the disk.
+//
+// ASYNC_LOG_I / _W / _E format a printf style message into a fixed-size
+// slot and push it on a lock-free queue; a background writer drains the
+// queue to the sink, by default stderr, in the app the cinder logger. A
+// full queue drops the message instead of waiting.
+//
+// Every call site is rate limited on its own: after burst messages within
+// one period the site stays quiet until the period ends, and its next
+// message reports how many were suppressed meanwhile.
+//
+// The ydlidar cache thread uses it only when MINIAREASCAN_ASYNC_LOG is
+// defined, so the SDK can be built standalone without it.
+
+#include <atomic>
+#include <functional>
+#include <stdint.h>
+
+namespace asynclog
+{
+    enum Level
+    {
+        LEVEL_INFO,
+        LEVEL_WARNING,
+        LEVEL_ERROR,
+    };
+
+    // Rate limiting state of one call site, a static in the macros below.
+    struct Site
+    {
+        Site(const char *file = "", int line = 0) : file(file), line(line) {}
+
+        const char *file;
+        int line;
+        std::atomic<uint64_t> periodStartUs{ 0 };
+        std::atomic<uint32_t> count{ 0 };
+        std::atomic<uint32_t> suppressed{ 0 };
+    };
+
+    // Called on the writer thread only. suppressed counts the messages of
+    // the same site that were held back before this one.
+    typedef std::function<void(Level level, const char *file, int line, const char *text, uint32_t suppressed)> Sink;
+
+    // Set it before the first message, or after stop().
+    void setSink(Sink sink);
+
+    // Messages per site and period, burst 0 turns the rate limit off.
+    void setRateLimit(int burst, int periodMs);
+
+    // Returns false when the message was suppressed or dropped. Starts the
+    // writer thread on first use.
+    bool write(Site &site, Level level, const char *format, ...);
+
+    // Writes what is queued, joins the writer thread and goes back to the
+    // stderr sink. A later message starts the writer again.
+    void stop();
+
+    // Totals since the start.
+    uint64_t getSuppressedCount();  // held back by the rate limit
+    uint64_t getDroppedCount();     // lost to a full queue
+}
+
+#define ASYNC_LOG_(level, ...) do { \
+        static asynclog::Site _asyncLogSite(__FILE__, __LINE__); \
+        asynclog::write(_asyncLogSite, asynclog::level, __VA_ARGS__); \
+    } while (0)
+#define ASYNC_LOG_I(...) ASYNC_LOG_(LEVEL_INFO, __VA_ARGS__)
+#define ASYNC_LOG_W(...) ASYNC_LOG_(LEVEL_WARNING, __VA_ARGS__)
+#define ASYNC_LOG_E(...) ASYNC_LOG_(LEVEL_ERROR, __VA_ARGS__)
@@ -0,0 +1,99 @@
+#pragma once
+
+/*
+ * C API of the MiniAreaScan tracker library, for linking the tracker
+ * in-process instead of running MiniAreaScan and parsing TUIO.
+ *
+ *     mas_options options;
+ *     mas_default_options(&options);
+ *     mas_tracker *tracker = mas_open(MAS_DEVICE_RPLIDAR, "COM4", &options);
+ *     mas_set_frame_callback(tracker, onFrame, userData);
+ *     mas_start(tracker);
+ *     ...
+ *     mas_close(tracker);
+ *
+ * The frame callback runs on the tracker's processing thread, the device is
+ * read on a separate acquisition thread. When processing or the callback
+ * falls behind, the oldest waiting scan is dropped. The arrays in mas_frame
+ * point into the tracker's own buffers and are only valid until the callback
+ * returns; copy what you need to keep.
+ */
+
+#include <stdint.h>
+#include "MiniAreaScanShm.h"
+
+#if defined(_WIN32)
+#if defined(MINIAREASCAN_LIB_EXPORTS)
+#define MAS_API __declspec(dllexport)
+#else
+#define MAS_API __declspec(dllimport)
+#endif
+#else
+#define MAS_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MAS_API_VERSION 1
+
+enum
+{
+    MAS_DEVICE_RPLIDAR = 0,
+    MAS_DEVICE_YDLIDAR = 1,
+};
+
+typedef struct mas_tracker mas_tracker;
+
+typedef struct mas_options
+{
+    int32_t frame_width;    /* raster size in pixel, blob coordinates use it */
+    int32_t frame_height;
+    float mm_to_pixel;
+    float base_angle;       /* degree */
+    float dot_radius;       /* pixel */
+    float min_area;         /* pixel^2 */
+} mas_options;
+
+typedef struct mas_scan_point
+{
+    float dist;             /* millimeter */
+    float angle;            /* degree */
+    int32_t valid;
+} mas_scan_point;
+
+typedef struct mas_frame
+{
+    uint32_t frame;
+    uint64_t timestamp_us;
+    uint32_t frame_width;
+    uint32_t frame_height;
+    const mas_scan_point *points;
+    uint32_t point_count;
+    const mas_blob *blobs;
+    uint32_t blob_count;
+} mas_frame;
+
+typedef void (*mas_frame_callback)(const mas_frame *frame, void *user_data);
+
+MAS_API uint32_t mas_api_version(void);
+MAS_API void mas_default_options(mas_options *options);
+
+/* Returns NULL when the device could not be opened. */
+MAS_API mas_tracker *mas_open(int32_t device_type, const char *serial_port, const mas_options *options);
+MAS_API void mas_close(mas_tracker *tracker);
+
+/* Must be called while the tracker is stopped. */
+MAS_API void mas_set_frame_callback(mas_tracker *tracker, mas_frame_callback callback, void *user_data);
+
+/* Starts / stops the acquisition and processing threads, returns 0 on success. */
+MAS_API int32_t mas_start(mas_tracker *tracker);
+MAS_API void mas_stop(mas_tracker *tracker);
+
+/* Last status message of the device, valid until the next mas_status() call on the same thread. */
+MAS_API const char *mas_status(mas_tracker *tracker);
+
+#ifdef __cplusplus
+}
+#endif
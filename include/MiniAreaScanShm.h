@@ -0,0 +1,145 @@
+#pragma once
+
+/*
+ * Shared-memory layout of the MiniAreaScan blob output, for readers written
+ * in C or C++ on the same machine. Enable it with SHM_ENABLED in the app.
+ *
+ * The tracker publishes every frame into the next slot of a small ring. Each
+ * slot is guarded by a sequence counter that is odd while the slot is being
+ * written (seqlock), so readers never block the tracker:
+ *
+ *     const mas_shm_header *shm = mas_shm_map("/miniareascan");
+ *     for (;;)
+ *     {
+ *         const mas_shm_slot *slot = mas_shm_latest(shm);
+ *         uint32_t seq;
+ *         if (mas_shm_read_begin(slot, &seq) != MAS_SHM_OK) break; // tracker stalled mid-write
+ *         ... read slot->blobs[0 .. slot->blob_count) in place ...
+ *         if (mas_shm_read_end(slot, seq)) break; // otherwise it was overwritten, retry
+ *     }
+ *
+ * All coordinates are in pixels of the slot's frame_width x frame_height raster.
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MAS_SHM_MAGIC       0x3153414Du /* "MAS1" */
+#define MAS_SHM_VERSION     1
+#define MAS_SHM_SLOT_COUNT  4
+#define MAS_SHM_MAX_BLOBS   256
+#define MAS_SHM_DEFAULT_NAME "/miniareascan"
+
+/* How often mas_shm_read_begin() looks at a slot that is being written before giving up. */
+#define MAS_SHM_SPIN_LIMIT  100000
+
+#define MAS_SHM_OK          0
+#define MAS_SHM_BUSY        1   /* the slot stayed odd, e.g. the tracker died while writing it */
+
+typedef struct mas_blob
+{
+    int32_t id;
+    float center_x, center_y;
+    float velocity_x, velocity_y;
+    int32_t box_x, box_y, box_width, box_height;
+    float rot_center_x, rot_center_y;
+    float rot_width, rot_height;
+    float rot_angle;        /* degrees, as cv::RotatedRect */
+    float area;
+} mas_blob;
+
+typedef struct mas_shm_slot
+{
+    volatile uint32_t seq;  /* odd while being written */
+    uint32_t frame;
+    uint64_t timestamp_us;  /* monotonic clock of the tracker */
+    uint32_t frame_width;
+    uint32_t frame_height;
+    uint32_t blob_count;
+    uint32_t reserved;
+    mas_blob blobs[MAS_SHM_MAX_BLOBS];
+} mas_shm_slot;
+
+typedef struct mas_shm_header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t max_blobs;
+    volatile uint32_t latest_frame; /* frame number of the newest complete slot */
+    uint32_t reserved;
+    mas_shm_slot slots[MAS_SHM_SLOT_COUNT];
+} mas_shm_header;
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#if defined(_M_ARM64)
+#define MAS_SHM_BARRIER() __dmb(_ARM64_BARRIER_ISH)
+#elif defined(_M_ARM)
+#define MAS_SHM_BARRIER() __dmb(_ARM_BARRIER_ISH)
+#else
+/* x86 and x64 keep loads and stores in order, only the compiler must not reorder them */
+#define MAS_SHM_BARRIER() _ReadWriteBarrier()
+#endif
+#else
+#define MAS_SHM_BARRIER() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#endif
+
+static inline const mas_shm_slot *mas_shm_latest(const mas_shm_header *shm)
+{
+    return &shm->slots[shm->latest_frame % MAS_SHM_SLOT_COUNT];
+}
+
+/* Returns MAS_SHM_BUSY when the slot is still being written after MAS_SHM_SPIN_LIMIT tries. */
+static inline int mas_shm_read_begin(const mas_shm_slot *slot, uint32_t *seq)
+{
+    int spins = 0;
+    while ((*seq = slot->seq) & 1)
+    {
+        if (++spins >= MAS_SHM_SPIN_LIMIT) return MAS_SHM_BUSY;
+    }
+    MAS_SHM_BARRIER();
+    return MAS_SHM_OK;
+}
+
+/* Returns non-zero when the slot was not modified since mas_shm_read_begin(). */
+static inline int mas_shm_read_end(const mas_shm_slot *slot, uint32_t seq)
+{
+    MAS_SHM_BARRIER();
+    return slot->seq == seq;
+}
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/* Maps the segment read-only, returns NULL if it does not exist or does not match this header. */
+static inline const mas_shm_header *mas_shm_map(const char *name)
+{
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) return 0;
+    void *p = mmap(0, sizeof(mas_shm_header), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return 0;
+    const mas_shm_header *shm = (const mas_shm_header *)p;
+    if (shm->magic != MAS_SHM_MAGIC || shm->version != MAS_SHM_VERSION)
+    {
+        munmap(p, sizeof(mas_shm_header));
+        return 0;
+    }
+    return shm;
+}
+
+static inline void mas_shm_unmap(const mas_shm_header *shm)
+{
+    munmap((void *)shm, sizeof(mas_shm_header));
+}
+#endif
+
+#ifdef __cplusplus
+}
+#endif
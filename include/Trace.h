@@ -0,0 +1,55 @@
+#pragma once
+
+// Lightweight scoped trace events for timeline analysis.
+//
+// Events are written to a fixed-size ring buffer from any thread, and can be
+// flushed on demand to Chrome / Perfetto JSON trace format
+// (load it in chrome://tracing or https://ui.perfetto.dev).
+//
+// Tracing is compiled in only when MINIAREASCAN_TRACE is defined, so the SDKs
+// can be built standalone without it. At runtime it is disabled by default.
+
+#if defined(MINIAREASCAN_TRACE)
+
+#include <stdint.h>
+
+namespace trace
+{
+    void setEnabled(bool enabled);
+    bool isEnabled();
+
+    // Names the calling thread in the exported timeline.
+    void setThreadName(const char *name);
+
+    // name must be a string literal (or otherwise outlive the trace buffer).
+    void addEvent(const char *name, uint64_t startUs, uint64_t endUs);
+
+    uint64_t nowUs();
+
+    // Writes all buffered events to path, returns the number of events written.
+    int flush(const char *path);
+
+    struct Scope
+    {
+        Scope(const char *name) : name(name), startUs(isEnabled() ? nowUs() : 0) {}
+        ~Scope()
+        {
+            if (startUs != 0) addEvent(name, startUs, nowUs());
+        }
+
+        const char *name;
+        uint64_t startUs;
+    };
+}
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) trace::Scope TRACE_CONCAT(_traceScope, __LINE__)(name)
+#define TRACE_THREAD_NAME(name) trace::setThreadName(name)
+
+#else
+
+#define TRACE_SCOPE(name)
+#define TRACE_THREAD_NAME(name)
+
+#endif
@@ -60,6 +60,13 @@ struct RplidarScanMode {
     char    scan_mode[64];    // name of scan mode, max 63 characters
 };
 
+struct RplidarPacketJitter {
+    _u32    packet_count;     // packets received since the previous call
+    float   mean_us;          // mean interval between two packets
+    float   stddev_us;        // standard deviation of that interval
+    float   max_us;           // longest interval
+};
+
 enum {
     DRIVER_TYPE_SERIALPORT = 0x0,
     DRIVER_TYPE_TCP = 0x1,
@@ -310,6 +317,22 @@ public:
     /// The interface will return RESULT_OPERATION_TIMEOUT to indicate that not even a single node can be retrieved since last call. 
     virtual u_result getScanDataWithIntervalHq(rplidar_response_measurement_node_hq_t * nodebuffer, size_t & count) = 0;
 
+    /// Set the scheduling of the background thread that caches the scan data.
+    /// The settings are kept and applied to every cache thread started later on, and to the running one.
+    ///
+    /// \param priority      SCHED_FIFO priority of the thread (1-99), 0 keeps the normal scheduling.
+    ///                      On Windows any priority raises the thread, 50 and above to time critical.
+    /// \param roundRobin    Use SCHED_RR instead of SCHED_FIFO.
+    /// \param cpuMask       CPUs the thread may run on, bit n for cpu n, 0 for all of them.
+    /// \param lockMemory    Lock the scan caches of the driver into RAM so they never page out.
+    ///
+    /// Realtime priorities usually need elevated rights, RESULT_OPERATION_FAIL is returned when they are denied.
+    virtual u_result setCacheThreadScheduling(int priority, bool roundRobin, _u64 cpuMask, bool lockMemory) = 0;
+
+    /// Retrieve the arrival statistics of the measurement packets received by the background thread
+    /// since the previous call, and start over.
+    virtual u_result getPacketJitter(RplidarPacketJitter & jitter) = 0;
+
     virtual ~RPlidarDriver() {}
 protected:
     RPlidarDriver(){}
@@ -72,27 +72,29 @@ u_result Thread::setPriority( priority_val_t p)
         return RESULT_OPERATION_FAIL;
     }   
 
-    //int pthread_priority = 0 ;
+    int pthread_priority_max = sched_get_priority_max(SCHED_RR);
+    int pthread_priority_min = sched_get_priority_min(SCHED_RR);
+    int pthread_priority = 0 ;
 
     switch(p)
     {
     case PRIORITY_REALTIME:
-        //pthread_priority = pthread_priority_max;
+        pthread_priority = pthread_priority_max;
         current_policy = SCHED_RR;
         break;
     case PRIORITY_HIGH:
-        //pthread_priority = (pthread_priority_max + pthread_priority_min)/2;
+        pthread_priority = (pthread_priority_max + pthread_priority_min)/2;
         current_policy = SCHED_RR;
         break;
     case PRIORITY_NORMAL:
     case PRIORITY_LOW:
     case PRIORITY_IDLE:
-        //pthread_priority = 0;
+        pthread_priority = 0;
         current_policy = SCHED_OTHER;
         break;
     }
 
-    current_param.__sched_priority = current_policy;
+    current_param.sched_priority = pthread_priority;
     if ( (ans = pthread_setschedparam( (pthread_t) this->_handle, current_policy, &current_param)) )
     {
         return RESULT_OPERATION_FAIL;
@@ -126,6 +128,51 @@ Thread::priority_val_t Thread::getPriority()
     return PRIORITY_NORMAL;
 }
 
+u_result Thread::setRealtime(int priority, bool roundRobin)
+{
+    if (!this->_handle) return RESULT_OPERATION_FAIL;
+
+    struct sched_param param;
+    int policy = SCHED_OTHER;
+    param.sched_priority = 0;
+    if (priority > 0)
+    {
+        policy = roundRobin ? SCHED_RR : SCHED_FIFO;
+        int priority_max = sched_get_priority_max(policy);
+        int priority_min = sched_get_priority_min(policy);
+        param.sched_priority = priority < priority_min ? priority_min : (priority > priority_max ? priority_max : priority);
+    }
+
+    // needs CAP_SYS_NICE or an rtprio limit for the realtime policies
+    if (pthread_setschedparam((pthread_t) this->_handle, policy, &param))
+    {
+        return RESULT_OPERATION_FAIL;
+    }
+    return RESULT_OK;
+}
+
+u_result Thread::setAffinity(_u64 cpuMask)
+{
+    if (!this->_handle) return RESULT_OPERATION_FAIL;
+
+    long cpu_count = sysconf(_SC_NPROCESSORS_CONF);
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    for (long cpu = 0; cpu < cpu_count && cpu < CPU_SETSIZE; ++cpu)
+    {
+        if (!cpuMask || (cpu < 64 && (cpuMask & ((_u64)1 << cpu))))
+        {
+            CPU_SET(cpu, &cpus);
+        }
+    }
+
+    if (pthread_setaffinity_np((pthread_t) this->_handle, sizeof(cpus), &cpus))
+    {
+        return RESULT_OPERATION_FAIL;
+    }
+    return RESULT_OK;
+}
+
 u_result Thread::join(unsigned long timeout)
 {
     if (!this->_handle) return RESULT_OK;
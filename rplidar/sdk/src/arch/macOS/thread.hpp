@@ -68,6 +68,34 @@ Thread::priority_val_t Thread::getPriority()
 	return PRIORITY_NORMAL;
 }
 
+u_result Thread::setRealtime(int priority, bool roundRobin)
+{
+    if (!this->_handle) return RESULT_OPERATION_FAIL;
+
+    struct sched_param param;
+    int policy = SCHED_OTHER;
+    param.sched_priority = 0;
+    if (priority > 0)
+    {
+        policy = roundRobin ? SCHED_RR : SCHED_FIFO;
+        int priority_max = sched_get_priority_max(policy);
+        int priority_min = sched_get_priority_min(policy);
+        param.sched_priority = priority < priority_min ? priority_min : (priority > priority_max ? priority_max : priority);
+    }
+
+    if (pthread_setschedparam((pthread_t) this->_handle, policy, &param))
+    {
+        return RESULT_OPERATION_FAIL;
+    }
+    return RESULT_OK;
+}
+
+u_result Thread::setAffinity(_u64 cpuMask)
+{
+    // macOS only offers affinity hints through mach, not supported
+    return cpuMask ? RESULT_OPERATION_NOT_SUPPORT : RESULT_OK;
+}
+
 u_result Thread::join(unsigned long timeout)
 {
     if (!this->_handle) return RESULT_OK;
@@ -123,6 +123,46 @@ Thread::priority_val_t Thread::getPriority()
 	return PRIORITY_NORMAL;
 }
 
+u_result Thread::setRealtime(int priority, bool roundRobin)
+{
+	if (!this->_handle) return RESULT_OPERATION_FAIL;
+
+	// windows has no per thread policy, map the level onto the thread priorities
+	// within the process class; roundRobin has no counterpart
+	int win_priority = THREAD_PRIORITY_NORMAL;
+	if (priority >= 50)
+	{
+		win_priority = THREAD_PRIORITY_TIME_CRITICAL;
+	}
+	else if (priority > 0)
+	{
+		win_priority = THREAD_PRIORITY_HIGHEST;
+	}
+
+	if (SetThreadPriority(reinterpret_cast<HANDLE>(this->_handle), win_priority))
+	{
+		return RESULT_OK;
+	}
+	return RESULT_OPERATION_FAIL;
+}
+
+u_result Thread::setAffinity(_u64 cpuMask)
+{
+	if (!this->_handle) return RESULT_OPERATION_FAIL;
+
+	DWORD_PTR process_mask, system_mask;
+	if (!GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask))
+	{
+		return RESULT_OPERATION_FAIL;
+	}
+	DWORD_PTR mask = cpuMask ? (DWORD_PTR)cpuMask & process_mask : process_mask;
+	if (!mask || !SetThreadAffinityMask(reinterpret_cast<HANDLE>(this->_handle), mask))
+	{
+		return RESULT_OPERATION_FAIL;
+	}
+	return RESULT_OK;
+}
+
 u_result Thread::join(unsigned long timeout)
 {
     if (!this->_handle) return RESULT_OK;
@@ -74,6 +74,11 @@ public:
     u_result join(unsigned long timeout = -1);
 	u_result setPriority( priority_val_t p);
 	priority_val_t getPriority();
+	// priority > 0 selects SCHED_FIFO (SCHED_RR with roundRobin) at that level,
+	// clamped to the range of the policy; 0 goes back to normal scheduling
+	u_result setRealtime(int priority, bool roundRobin = false);
+	// bit n of cpuMask allows cpu n, 0 allows all of them
+	u_result setAffinity(_u64 cpuMask);
 
     bool operator== ( const Thread & right) { return this->_handle == right._handle; }
 protected:
@@ -46,6 +46,11 @@
 #include "rplidar_driver_TCP.h"
 
 #include <algorithm>
+#include <chrono>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
 
 #ifndef min
 #define min(a,b)            (((a) < (b)) ? (a) : (b))
@@ -81,6 +86,21 @@ static void convert(const rplidar_response_measurement_node_hq_t& from, rplidar_
     to.distance_q2 = from.dist_mm_q2 > _u16(-1) ? _u16(0) : _u16(from.dist_mm_q2);
 }
 
+static _u64 getPacketTimeUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool lockPages(void * addr, size_t size, bool lock)
+{
+#ifdef _WIN32
+    return (lock ? VirtualLock(addr, size) : VirtualUnlock(addr, size)) != FALSE;
+#else
+    return (lock ? mlock(addr, size) : munlock(addr, size)) == 0;
+#endif
+}
+
 // Factory Impl
 RPlidarDriver * RPlidarDriver::CreateDriver(_u32 drivertype)
 {
@@ -110,6 +130,18 @@ RPlidarDriverImplCommon::RPlidarDriverImplCommon()
     _cached_scan_node_hq_count_for_interval_retrieve = 0;
     _cached_sampleduration_std = LEGACY_SAMPLE_DURATION;
     _cached_sampleduration_express = LEGACY_SAMPLE_DURATION;
+    _cache_priority = 0;
+    _cache_round_robin = false;
+    _cache_cpu_mask = 0;
+    _memory_locked = false;
+    _packet_last_us = 0;
+    memset(&_packet_pending, 0, sizeof(_packet_pending));
+    memset(&_packet_stats, 0, sizeof(_packet_stats));
+}
+
+RPlidarDriverImplCommon::~RPlidarDriverImplCommon()
+{
+    if (_memory_locked) lockPages(this, sizeof(RPlidarDriverImplCommon), false);
 }
 
 bool RPlidarDriverImplCommon::isConnected()
@@ -353,6 +385,7 @@ u_result RPlidarDriverImplCommon::_waitScanData(rplidar_response_measurement_nod
         if (IS_FAIL(ans = _waitNode(&node, timeout - waitTime))) {
             return ans;
         }
+        _recordPacket();
         
         nodebuffer[recvNodeCount++] = node;
 
@@ -532,6 +565,7 @@ u_result RPlidarDriverImplCommon::_waitUltraCapsuledNode(rplidar_response_ultra_
 
 u_result RPlidarDriverImplCommon::_cacheScanData()
 {
+    TRACE_THREAD_NAME("rplidar cache (normal)");
     rplidar_response_measurement_node_t      local_buf[128];
     size_t                                   count = 128;
     rplidar_response_measurement_node_hq_t   local_scan[MAX_SCAN_NODES];
@@ -557,11 +591,13 @@ u_result RPlidarDriverImplCommon::_cacheScanData()
                 // only publish the data when it contains a full 360 degree scan 
                 
                 if ((local_scan[0].flag & RPLIDAR_RESP_MEASUREMENT_SYNCBIT)) {
+                    TRACE_SCOPE("rplidar publish scan");
                     _lock.lock();
                     memcpy(_cached_scan_node_hq_buf, local_scan, scan_count*sizeof(rplidar_response_measurement_node_hq_t));
                     _cached_scan_node_hq_count = scan_count;
                     _dataEvt.set();
                     _lock.unlock();
+                    _publishPackets();
                 }
                 scan_count = 0;
             }
@@ -619,6 +655,7 @@ u_result RPlidarDriverImplCommon::startScanNormal(bool force,  _u32 timeout)
         if (_cachethread.getHandle() == 0) {
             return RESULT_OPERATION_FAIL;
         }
+        _scheduleCacheThread(_cache_cpu_mask != 0, _cache_priority != 0);
     }
     return RESULT_OK;
 }
@@ -647,6 +684,7 @@ u_result RPlidarDriverImplCommon::checkExpressScanSupported(bool & support, _u32
 
 u_result RPlidarDriverImplCommon::_cacheCapsuledScanData()
 {
+    TRACE_THREAD_NAME("rplidar cache (express)");
     rplidar_response_capsule_measurement_nodes_t    capsule_node;
     rplidar_response_measurement_node_hq_t   local_buf[128];
     size_t                                   count = 128;
@@ -672,6 +710,7 @@ u_result RPlidarDriverImplCommon::_cacheCapsuledScanData()
             }
         }
         
+        _recordPacket();
         _capsuleToNormal(capsule_node, local_buf, count);
 
         for (size_t pos = 0; pos < count; ++pos)
@@ -681,11 +720,13 @@ u_result RPlidarDriverImplCommon::_cacheCapsuledScanData()
                 // only publish the data when it contains a full 360 degree scan 
                 
                 if ((local_scan[0].flag & RPLIDAR_RESP_MEASUREMENT_SYNCBIT)) {
+                    TRACE_SCOPE("rplidar publish scan");
                     _lock.lock();
                     memcpy(_cached_scan_node_hq_buf, local_scan, scan_count*sizeof(rplidar_response_measurement_node_hq_t));
                     _cached_scan_node_hq_count = scan_count;
                     _dataEvt.set();
                     _lock.unlock();
+                    _publishPackets();
                 }
                 scan_count = 0;
             }
@@ -707,6 +748,7 @@ u_result RPlidarDriverImplCommon::_cacheCapsuledScanData()
 
 u_result RPlidarDriverImplCommon::_cacheUltraCapsuledScanData()
 {
+    TRACE_THREAD_NAME("rplidar cache (ultra)");
     rplidar_response_ultra_capsule_measurement_nodes_t    ultra_capsule_node;
     rplidar_response_measurement_node_hq_t   local_buf[128];
     size_t                                   count = 128;
@@ -729,6 +771,7 @@ u_result RPlidarDriverImplCommon::_cacheUltraCapsuledScanData()
             }
         }
         
+        _recordPacket();
         _ultraCapsuleToNormal(ultra_capsule_node, local_buf, count);
         
         for (size_t pos = 0; pos < count; ++pos)
@@ -738,11 +781,13 @@ u_result RPlidarDriverImplCommon::_cacheUltraCapsuledScanData()
                 // only publish the data when it contains a full 360 degree scan 
                 
                 if ((local_scan[0].flag & RPLIDAR_RESP_MEASUREMENT_SYNCBIT)) {
+                    TRACE_SCOPE("rplidar publish scan");
                     _lock.lock();
                     memcpy(_cached_scan_node_hq_buf, local_scan, scan_count*sizeof(rplidar_response_measurement_node_hq_t));
                     _cached_scan_node_hq_count = scan_count;
                     _dataEvt.set();
                     _lock.unlock();
+                    _publishPackets();
                 }
                 scan_count = 0;
             }
@@ -824,6 +869,7 @@ void     RPlidarDriverImplCommon::_capsuleToNormal(const rplidar_response_capsul
 //*******************************************HQ support********************************
 u_result RPlidarDriverImplCommon::_cacheHqScanData()
 {
+    TRACE_THREAD_NAME("rplidar cache (hq)");
     rplidar_response_hq_capsule_measurement_nodes_t    hq_node;
     rplidar_response_measurement_node_hq_t   local_buf[128];
     size_t                                   count = 128;
@@ -844,6 +890,7 @@ u_result RPlidarDriverImplCommon::_cacheHqScanData()
             }
         }
 
+        _recordPacket();
         _HqToNormal(hq_node, local_buf, count);
         for (size_t pos = 0; pos < count; ++pos)
         {
@@ -851,11 +898,13 @@ u_result RPlidarDriverImplCommon::_cacheHqScanData()
             {
 				// only publish the data when it contains a full 360 degree scan 
                 if ((local_scan[0].flag & RPLIDAR_RESP_MEASUREMENT_SYNCBIT)) {
+                    TRACE_SCOPE("rplidar publish scan");
                     _lock.lock();
                     memcpy(_cached_scan_node_hq_buf, local_scan, scan_count * sizeof(rplidar_response_measurement_node_hq_t));
                     _cached_scan_node_hq_count = scan_count;
                     _dataEvt.set();
                     _lock.unlock();
+                    _publishPackets();
                 }
                 scan_count = 0;
             }
@@ -933,14 +982,13 @@ static _u32 _crc32cal(_u32 crc, void* input, _u16 len)
     return crc^0xffffffff;
 }
 
+// built once at startup, the cache threads of several drivers may checksum concurrently
+static struct _crc32_table_init {
+	_crc32_table_init() { _crc32_init(0x4C11DB7); }
+} _crc32_table_init_instance;
+
 //crc32cal
 static u_result _crc32(_u8 *ptr, _u32 len) {
-	static _u8 tmp;
-	if (tmp != 1) {
-		_crc32_init(0x4C11DB7);
-		tmp = 1;
-	}
-	
 	return _crc32cal(0xFFFFFFFF, ptr,len);
 }
 
@@ -1675,6 +1723,7 @@ u_result RPlidarDriverImplCommon::startScanExpress(bool force, _u16 scanMode, _u
         if (_cachethread.getHandle() == 0) {
             return RESULT_OPERATION_FAIL;
         }
+        _scheduleCacheThread(_cache_cpu_mask != 0, _cache_priority != 0);
     }
     return RESULT_OK;
 }
@@ -1728,6 +1777,7 @@ u_result RPlidarDriverImplCommon::grabScanData(rplidar_response_measurement_node
 
 u_result RPlidarDriverImplCommon::grabScanDataHq(rplidar_response_measurement_node_hq_t * nodebuffer, size_t & count, _u32 timeout)
 {
+    TRACE_SCOPE("rplidar grabScanDataHq");
     switch (_dataEvt.wait(timeout))
     {
     case rp::hal::Event::EVENT_TIMEOUT:
@@ -2090,6 +2140,93 @@ void RPlidarDriverImplCommon::_disableDataGrabbing()
 {
     _isScanning = false;
     _cachethread.join();
+
+    _packet_last_us = 0;
+    memset(&_packet_pending, 0, sizeof(_packet_pending));
+}
+
+u_result RPlidarDriverImplCommon::setCacheThreadScheduling(int priority, bool roundRobin, _u64 cpuMask, bool lockMemory)
+{
+    u_result ans = RESULT_OK;
+    {
+        rp::hal::AutoLocker l(_lock);
+        bool affinityChanged = cpuMask != _cache_cpu_mask;
+        bool priorityChanged = priority != _cache_priority || roundRobin != _cache_round_robin;
+        _cache_priority = priority;
+        _cache_round_robin = roundRobin;
+        _cache_cpu_mask = cpuMask;
+
+        if (lockMemory != _memory_locked) {
+            // the caches live inside the driver object
+            if (lockPages(this, sizeof(RPlidarDriverImplCommon), lockMemory)) {
+                _memory_locked = lockMemory;
+            } else {
+                ans = RESULT_OPERATION_FAIL;
+            }
+        }
+
+        if (_isScanning) {
+            u_result threadAns = _scheduleCacheThread(affinityChanged, priorityChanged);
+            if (IS_OK(ans)) ans = threadAns;
+        }
+    }
+    return ans;
+}
+
+u_result RPlidarDriverImplCommon::_scheduleCacheThread(bool affinity, bool priority)
+{
+    if (_cachethread.getHandle() == 0) return RESULT_OPERATION_FAIL;
+
+    // only touch what was asked for, a new thread inherits the affinity of the process
+    u_result ans = RESULT_OK;
+    if (affinity) {
+        ans = _cachethread.setAffinity(_cache_cpu_mask);
+    }
+    if (priority) {
+        u_result priorityAns = _cachethread.setRealtime(_cache_priority, _cache_round_robin);
+        if (IS_OK(ans)) ans = priorityAns;
+    }
+    return ans;
+}
+
+void RPlidarDriverImplCommon::_recordPacket()
+{
+    _u64 now = getPacketTimeUs();
+    if (_packet_last_us) {
+        _u64 interval = now - _packet_last_us;
+        _packet_pending.count++;
+        _packet_pending.sum_us += (double)interval;
+        _packet_pending.sumsq_us += (double)interval * interval;
+        if (interval > _packet_pending.max_us) _packet_pending.max_us = interval;
+    }
+    _packet_last_us = now;
+}
+
+void RPlidarDriverImplCommon::_publishPackets()
+{
+    rp::hal::AutoLocker l(_packet_lock);
+    _packet_stats.count += _packet_pending.count;
+    _packet_stats.sum_us += _packet_pending.sum_us;
+    _packet_stats.sumsq_us += _packet_pending.sumsq_us;
+    if (_packet_pending.max_us > _packet_stats.max_us) _packet_stats.max_us = _packet_pending.max_us;
+    memset(&_packet_pending, 0, sizeof(_packet_pending));
+}
+
+u_result RPlidarDriverImplCommon::getPacketJitter(RplidarPacketJitter & jitter)
+{
+    rp::hal::AutoLocker l(_packet_lock);
+    jitter.packet_count = _packet_stats.count;
+    jitter.mean_us = 0;
+    jitter.stddev_us = 0;
+    jitter.max_us = (float)_packet_stats.max_us;
+    if (_packet_stats.count) {
+        double mean = _packet_stats.sum_us / _packet_stats.count;
+        double variance = _packet_stats.sumsq_us / _packet_stats.count - mean * mean;
+        jitter.mean_us = (float)mean;
+        jitter.stddev_us = variance > 0 ? (float)sqrt(variance) : 0;
+    }
+    memset(&_packet_stats, 0, sizeof(_packet_stats));
+    return RESULT_OK;
 }
 
 // Serial Driver Impl
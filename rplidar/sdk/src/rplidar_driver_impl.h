@@ -74,11 +74,16 @@ public:
     virtual u_result ascendScanData(rplidar_response_measurement_node_hq_t * nodebuffer, size_t count);
     virtual u_result getScanDataWithInterval(rplidar_response_measurement_node_t * nodebuffer, size_t & count);
     virtual u_result getScanDataWithIntervalHq(rplidar_response_measurement_node_hq_t * nodebuffer, size_t & count);
+    virtual u_result setCacheThreadScheduling(int priority, bool roundRobin, _u64 cpuMask, bool lockMemory);
+    virtual u_result getPacketJitter(RplidarPacketJitter & jitter);
 
 protected:
 
     virtual u_result _sendCommand(_u8 cmd, const void * payload = NULL, size_t payloadsize = 0);
     void     _disableDataGrabbing();
+    u_result _scheduleCacheThread(bool affinity, bool priority);
+    void     _recordPacket();
+    void     _publishPackets();
 
     virtual u_result _waitResponseHeader(rplidar_ans_header_t * header, _u32 timeout = DEFAULT_TIMEOUT);
     virtual u_result _cacheScanData();
@@ -121,8 +126,26 @@ protected:
     rp::hal::Event          _dataEvt;
     rp::hal::Thread _cachethread;
 
+    int                     _cache_priority;
+    bool                    _cache_round_robin;
+    _u64                    _cache_cpu_mask;
+    bool                    _memory_locked;
+
+    struct PacketStats {
+        _u32    count;
+        double  sum_us;
+        double  sumsq_us;
+        _u64    max_us;
+    };
+
+    // the cache thread accumulates without locking and publishes once per scan
+    _u64                    _packet_last_us;
+    PacketStats             _packet_pending;
+    rp::hal::Locker         _packet_lock;
+    PacketStats             _packet_stats;
+
 protected:
     RPlidarDriverImplCommon();
-    virtual ~RPlidarDriverImplCommon() {}
+    virtual ~RPlidarDriverImplCommon();
 };
 }}}
\ No newline at end of file
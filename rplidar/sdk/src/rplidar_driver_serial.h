@@ -65,6 +65,7 @@ public:
     }
     bool waitfordata(size_t data_count,_u32 timeout = -1, size_t * returned_size = NULL)
     {
+        TRACE_SCOPE("rplidar serial waitfordata");
         if (_closePending) return false;
         return (_rxtxSerial->waitfordata(data_count, timeout, returned_size) == rp::hal::serial_rxtx::ANS_OK);
     }
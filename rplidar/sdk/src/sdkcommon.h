@@ -47,4 +47,12 @@
 
 #include "rplidar.h"
 
+// optional timeline tracing, provided by the hosting application
+#if defined(MINIAREASCAN_TRACE)
+#include "Trace.h"
+#else
+#define TRACE_SCOPE(name)
+#define TRACE_THREAD_NAME(name)
+#endif
+
 #include "hal/util.h"
\ No newline at end of file
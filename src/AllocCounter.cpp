@@ -0,0 +1,208 @@
+#include "AllocCounter.h"
+
+#if defined(MINIAREASCAN_ALLOC_COUNTER)
+
+#include <atomic>
+#include <errno.h>
+#include <new>
+#include <stdlib.h>
+#if defined(_WIN32) && defined(_DEBUG)
+#include <crtdbg.h>
+#endif
+
+// Nothing in here may allocate: the counters are plain atomics and
+// thread_local integers.
+
+namespace
+{
+    struct StageCounter
+    {
+        std::atomic<uint64_t> allocs;
+        std::atomic<uint64_t> frees;
+        std::atomic<uint64_t> bytes;
+    };
+
+    StageCounter sStages[alloc::STAGE_COUNT];
+
+    thread_local alloc::Stage tStage = alloc::STAGE_NONE;
+    thread_local uint64_t tAllocs = 0;
+    thread_local uint64_t tFrees = 0;
+    thread_local uint64_t tBytes = 0;
+
+    void countAlloc(size_t size)
+    {
+        tAllocs++;
+        tBytes += size;
+        StageCounter &counter = sStages[tStage];
+        counter.allocs.fetch_add(1, std::memory_order_relaxed);
+        counter.bytes.fetch_add(size, std::memory_order_relaxed);
+    }
+
+    void countFree()
+    {
+        tFrees++;
+        sStages[tStage].frees.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+namespace alloc
+{
+    const char *getStageName(Stage stage)
+    {
+        static const char *const names[STAGE_COUNT] = { "none", "acquisition", "detection", "tracking", "output" };
+        return stage >= 0 && stage < STAGE_COUNT ? names[stage] : "";
+    }
+
+    Counts getStageCounts(Stage stage)
+    {
+        const StageCounter &counter = sStages[stage];
+        return { counter.allocs.load(std::memory_order_relaxed), counter.frees.load(std::memory_order_relaxed),
+                 counter.bytes.load(std::memory_order_relaxed) };
+    }
+
+    Counts getThreadCounts()
+    {
+        return { tAllocs, tFrees, tBytes };
+    }
+
+    Scope::Scope(Stage stage) : previous(tStage)
+    {
+        tStage = stage;
+    }
+
+    Scope::~Scope()
+    {
+        tStage = previous;
+    }
+}
+
+#if defined(__GLIBC__)
+
+// Every allocation, including operator new and the ones inside OpenCV and
+// the lidar SDKs, ends up in malloc or, like cv::fastMalloc, in one of the
+// aligned variants.
+extern "C"
+{
+    void *__libc_malloc(size_t size);
+    void *__libc_calloc(size_t count, size_t size);
+    void *__libc_realloc(void *ptr, size_t size);
+    void *__libc_memalign(size_t alignment, size_t size);
+    void __libc_free(void *ptr);
+
+    void *malloc(size_t size)
+    {
+        countAlloc(size);
+        return __libc_malloc(size);
+    }
+
+    void *calloc(size_t count, size_t size)
+    {
+        countAlloc(count * size);
+        return __libc_calloc(count, size);
+    }
+
+    void *realloc(void *ptr, size_t size)
+    {
+        countAlloc(size);
+        return __libc_realloc(ptr, size);
+    }
+
+    void *memalign(size_t alignment, size_t size)
+    {
+        countAlloc(size);
+        return __libc_memalign(alignment, size);
+    }
+
+    void *aligned_alloc(size_t alignment, size_t size)
+    {
+        countAlloc(size);
+        return __libc_memalign(alignment, size);
+    }
+
+    int posix_memalign(void **ptr, size_t alignment, size_t size)
+    {
+        if (alignment % sizeof(void *) != 0 || (alignment & (alignment - 1)) != 0) return EINVAL;
+        countAlloc(size);
+        void *p = __libc_memalign(alignment, size);
+        if (!p) return ENOMEM;
+        *ptr = p;
+        return 0;
+    }
+
+    void free(void *ptr)
+    {
+        if (!ptr) return;
+        countFree();
+        __libc_free(ptr);
+    }
+}
+
+#elif defined(_WIN32) && defined(_DEBUG)
+
+// The debug CRT reports every heap operation of the modules that share it,
+// operator new included. OpenCV ships release DLLs with their own CRT, so
+// its allocations stay invisible and the check cannot enforce them here.
+namespace
+{
+    int allocHook(int allocType, void *, size_t size, int blockType, long, const unsigned char *, int)
+    {
+        // the CRT's own blocks, counting them could recurse
+        if (blockType == _CRT_BLOCK) return 1;
+        if (allocType == _HOOK_FREE) countFree();
+        else countAlloc(size);
+        return 1;
+    }
+
+    struct HookInstaller
+    {
+        HookInstaller() { _CrtSetAllocHook(allocHook); }
+    } sHookInstaller;
+}
+
+#else
+
+// The CRT malloc cannot be replaced here, so only the C++ allocations of
+// this module are counted; the OpenCV DLL and plain malloc stay invisible,
+// and the check cannot enforce them in this build.
+namespace
+{
+    void *countedNew(size_t size)
+    {
+        countAlloc(size);
+        return malloc(size ? size : 1);
+    }
+
+    void countedDelete(void *ptr)
+    {
+        if (!ptr) return;
+        countFree();
+        free(ptr);
+    }
+}
+
+void *operator new(size_t size)
+{
+    void *ptr = countedNew(size);
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void *operator new[](size_t size)
+{
+    void *ptr = countedNew(size);
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept { return countedNew(size); }
+void *operator new[](size_t size, const std::nothrow_t &) noexcept { return countedNew(size); }
+void operator delete(void *ptr) noexcept { countedDelete(ptr); }
+void operator delete[](void *ptr) noexcept { countedDelete(ptr); }
+void operator delete(void *ptr, const std::nothrow_t &) noexcept { countedDelete(ptr); }
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept { countedDelete(ptr); }
+void operator delete(void *ptr, size_t) noexcept { countedDelete(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { countedDelete(ptr); }
+
+#endif
+
+#endif
@@ -0,0 +1,176 @@
+#include "AsyncLog.h"
+#include "FrameQueue.h"
+#include "Trace.h"
+
+#include <chrono>
+#include <mutex>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+
+namespace
+{
+    struct Message
+    {
+        asynclog::Level level;
+        const char *file;
+        int line;
+        uint32_t suppressed;
+        char text[256];
+    };
+
+    const size_t kCapacity = 1024;
+
+    // how often the writer looks at the queue, producers never wake it up
+    const std::chrono::milliseconds kWriterPeriod(10);
+
+    void writeStderr(asynclog::Level level, const char *file, int line, const char *text, uint32_t suppressed)
+    {
+        static const char *names[] = { "info", "warning", "error" };
+        if (suppressed > 0) fprintf(stderr, "|%s| %s[%d] %s (%u suppressed)\n", names[level], file, line, text, suppressed);
+        else fprintf(stderr, "|%s| %s[%d] %s\n", names[level], file, line, text);
+    }
+
+    uint64_t nowUs()
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    struct Logger
+    {
+        ~Logger() { stop(); }
+
+        void start()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (running) return;
+            running = true;
+            thread = std::thread(&Logger::run, this);
+        }
+
+        void stop()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!running) return;
+                running = false;
+            }
+            thread.join();
+            std::lock_guard<std::mutex> lock(mutex);
+            sink = writeStderr;
+        }
+
+        void run()
+        {
+            TRACE_THREAD_NAME("log writer");
+            Message message;
+            for (;;)
+            {
+                // read the flag first, so that the last drain sees every message pushed before stop()
+                bool stopping = !running;
+                while (queue.tryPop(message))
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    sink(message.level, message.file, message.line, message.text, message.suppressed);
+                }
+                if (stopping) break;
+                std::this_thread::sleep_for(kWriterPeriod);
+            }
+        }
+
+        FrameQueue<Message> queue{ kCapacity };
+        std::mutex mutex;   // sink and the writer thread
+        asynclog::Sink sink = writeStderr;
+        std::thread thread;
+        std::atomic<bool> running{ false };
+
+        std::atomic<int> burst{ 5 };
+        std::atomic<uint64_t> periodUs{ 1000000 };
+        std::atomic<uint64_t> suppressedCount{ 0 };
+        std::atomic<uint64_t> droppedCount{ 0 };
+    };
+
+    Logger &getLogger()
+    {
+        static Logger logger;
+        return logger;
+    }
+}
+
+namespace asynclog
+{
+    void setSink(Sink sink)
+    {
+        Logger &logger = getLogger();
+        std::lock_guard<std::mutex> lock(logger.mutex);
+        logger.sink = sink ? sink : writeStderr;
+    }
+
+    void setRateLimit(int burst, int periodMs)
+    {
+        Logger &logger = getLogger();
+        logger.burst = burst;
+        logger.periodUs = (uint64_t)periodMs * 1000;
+    }
+
+    bool write(Site &site, Level level, const char *format, ...)
+    {
+        Logger &logger = getLogger();
+
+        uint32_t suppressed = 0;
+        int burst = logger.burst;
+        if (burst > 0)
+        {
+            uint64_t now = nowUs();
+            uint64_t periodStartUs = site.periodStartUs;
+            if (now - periodStartUs >= logger.periodUs && site.periodStartUs.compare_exchange_strong(periodStartUs, now))
+            {
+                site.count = 0;
+                suppressed = site.suppressed.exchange(0);
+            }
+            if (site.count.fetch_add(1) >= (uint32_t)burst)
+            {
+                site.suppressed++;
+                logger.suppressedCount++;
+                return false;
+            }
+        }
+
+        Message message;
+        message.level = level;
+        message.file = site.file;
+        message.line = site.line;
+        message.suppressed = suppressed;
+        va_list args;
+        va_start(args, format);
+        vsnprintf(message.text, sizeof(message.text), format, args);
+        va_end(args);
+        size_t length = strlen(message.text);
+        while (length > 0 && (message.text[length - 1] == '\n' || message.text[length - 1] == '\r')) message.text[--length] = 0;
+
+        if (!logger.running) logger.start();
+        if (!logger.queue.tryPush(message))
+        {
+            logger.droppedCount++;
+            return false;
+        }
+        return true;
+    }
+
+    void stop()
+    {
+        getLogger().stop();
+    }
+
+    uint64_t getSuppressedCount()
+    {
+        return getLogger().suppressedCount;
+    }
+
+    uint64_t getDroppedCount()
+    {
+        return getLogger().droppedCount;
+    }
+}
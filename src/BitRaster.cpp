@@ -0,0 +1,326 @@
+#include "BitRaster.h"
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace
+{
+    inline int countTrailingZeros(uint64_t v)
+    {
+#if defined(_MSC_VER)
+        unsigned long i;
+        _BitScanForward64(&i, v);
+        return (int)i;
+#else
+        return __builtin_ctzll(v);
+#endif
+    }
+
+    // sum of k^2 for k in [0, n]
+    inline double sumSquares(double n)
+    {
+        return n * (n + 1) * (2 * n + 1) / 6;
+    }
+
+    // first pixel >= x in [x, width) whose bit equals value, or width
+    int findBit(const uint64_t *row, int x, int width, bool value)
+    {
+        while (x < width)
+        {
+            uint64_t word = row[x >> 6];
+            if (!value) word = ~word;
+            word &= ~uint64_t(0) << (x & 63);
+            if (word)
+            {
+                return std::min(((x >> 6) << 6) + countTrailingZeros(word), width);
+            }
+            x = ((x >> 6) + 1) << 6;
+        }
+        return width;
+    }
+}
+
+void BitRaster::setup(int width, int height)
+{
+    mWidth = width;
+    mHeight = height;
+    mStride = (width + 63) / 64;
+    mWords.assign((size_t)mStride * height, 0);
+    mRowUsed.assign(height, 0);
+    mOutside.clear();
+}
+
+void BitRaster::clear()
+{
+    for (int y = 0; y < mHeight; y++)
+    {
+        if (!mRowUsed[y]) continue;
+        memset(&mWords[y * mStride], 0, mStride * sizeof(uint64_t));
+        mRowUsed[y] = 0;
+    }
+    mOutside.clear();
+}
+
+void BitRaster::resetOutside(int x, int y)
+{
+    for (size_t i = 0; i < mOutside.size(); i++)
+    {
+        if (mOutside[i].x != x || mOutside[i].y != y) continue;
+        mOutside[i] = mOutside.back();
+        mOutside.pop_back();
+        return;
+    }
+}
+
+void BitRaster::fillSpan(int x0, int x1, int y)
+{
+    x0 = std::max(x0, 0);
+    x1 = std::min(x1, mWidth - 1);
+    if (y < 0 || y >= mHeight || x0 > x1) return;
+    uint64_t *row = &mWords[y * mStride];
+    for (int i = x0 >> 6; i <= x1 >> 6; i++)
+    {
+        uint64_t mask = ~uint64_t(0);
+        if (i == x0 >> 6) mask &= ~uint64_t(0) << (x0 & 63);
+        if (i == x1 >> 6 && (x1 & 63) != 63) mask &= (uint64_t(1) << ((x1 & 63) + 1)) - 1;
+        row[i] |= mask;
+    }
+    mRowUsed[y] = 1;
+}
+
+void BitRaster::dilate(int radius, BitRaster &dst) const
+{
+    if (dst.mWidth != mWidth || dst.mHeight != mHeight) dst.setup(mWidth, mHeight);
+    dst.clear();
+    radius = std::max(radius, 0);
+
+    // half width of the disk on each row offset, as cv::circle fills it
+    mSpans.resize(radius + 1);
+    for (int dy = 0; dy <= radius; dy++)
+    {
+        mSpans[dy] = (int)sqrtf((float)(radius * radius - dy * dy));
+    }
+
+    const uint64_t lastMask = (mWidth & 63) ? (uint64_t(1) << (mWidth & 63)) - 1 : ~uint64_t(0);
+    const int marginWords = (radius + 63) / 64;
+    mRow.resize(mStride);
+    mNext.resize(mStride);
+
+    for (int y = 0; y < mHeight; y++)
+    {
+        if (!mRowUsed[y]) continue;
+        const uint64_t *src = &mWords[y * mStride];
+
+        // only the words the disks can reach
+        int first = 0, last = mStride - 1;
+        while (first < mStride && !src[first]) first++;
+        if (first == mStride) continue;
+        while (!src[last]) last--;
+        first = std::max(first - marginWords, 0);
+        last = std::min(last + marginWords, mStride - 1);
+
+        std::copy(src + first, src + last + 1, mRow.begin() + first);
+        for (int k = 0; k <= radius; k++)
+        {
+            if (k > 0)
+            {
+                // grow by one pixel on both sides
+                for (int i = first; i <= last; i++)
+                {
+                    uint64_t w = mRow[i];
+                    uint64_t left = (w << 1) | (i > first ? mRow[i - 1] >> 63 : 0);
+                    uint64_t right = (w >> 1) | (i < last ? mRow[i + 1] << 63 : 0);
+                    mNext[i] = w | left | right;
+                }
+                std::copy(mNext.begin() + first, mNext.begin() + last + 1, mRow.begin() + first);
+                mRow[mStride - 1] &= lastMask;
+            }
+
+            // rows at distance dy whose span is exactly k; spans decrease with dy
+            for (int dy = 0; dy <= radius; dy++)
+            {
+                if (mSpans[dy] != k) continue;
+                for (int sign = -1; sign <= 1; sign += 2)
+                {
+                    int ty = y + sign * dy;
+                    if (ty < 0 || ty >= mHeight || (dy == 0 && sign > 0)) continue;
+                    uint64_t *out = &dst.mWords[ty * mStride];
+                    for (int i = first; i <= last; i++) out[i] |= mRow[i];
+                    dst.mRowUsed[ty] = 1;
+                }
+            }
+        }
+    }
+
+    // disks of the points outside the frame, clipped row by row
+    for (const auto &pt : mOutside)
+    {
+        int dx = pt.x < 0 ? -pt.x : std::max(pt.x - (mWidth - 1), 0);
+        int dy = pt.y < 0 ? -pt.y : std::max(pt.y - (mHeight - 1), 0);
+        if (dx * dx + dy * dy > radius * radius) continue;
+        for (int oy = 0; oy <= radius; oy++)
+        {
+            int span = mSpans[oy];
+            dst.fillSpan(pt.x - span, pt.x + span, pt.y - oy);
+            if (oy > 0) dst.fillSpan(pt.x - span, pt.x + span, pt.y + oy);
+        }
+    }
+}
+
+void BitRaster::intersect(const BitRaster &a, const BitRaster &b)
+{
+    if (mWidth != a.mWidth || mHeight != a.mHeight) setup(a.mWidth, a.mHeight);
+    clear();
+    for (int y = 0; y < mHeight; y++)
+    {
+        if (!a.mRowUsed[y] || !b.mRowUsed[y]) continue;
+        const uint64_t *ra = &a.mWords[y * mStride];
+        const uint64_t *rb = &b.mWords[y * mStride];
+        uint64_t *out = &mWords[y * mStride];
+        for (int i = 0; i < mStride; i++) out[i] = ra[i] & rb[i];
+        mRowUsed[y] = 1;
+    }
+    if (mWidth == 0 || mHeight == 0) return;
+    for (const auto &pt : a.mOutside)
+    {
+        int x = std::min(std::max(pt.x, 0), mWidth - 1);
+        int y = std::min(std::max(pt.y, 0), mHeight - 1);
+        if (b.get(x, y)) mOutside.push_back(pt);
+    }
+}
+
+int BitRaster::find(int label)
+{
+    while (mParent[label] != label)
+    {
+        mParent[label] = mParent[mParent[label]];
+        label = mParent[label];
+    }
+    return label;
+}
+
+size_t BitRaster::label(std::vector<Region> &regions)
+{
+    regions.clear();
+    mParent.clear();
+    mStats.clear();
+    mPrevRuns.clear();
+
+    int prevY = -2;
+    for (int y = 0; y < mHeight; y++)
+    {
+        if (!mRowUsed[y]) continue;
+        const uint64_t *row = &mWords[y * mStride];
+        if (prevY != y - 1) mPrevRuns.clear();
+
+        mRuns.clear();
+        size_t p = 0;
+        int x = findBit(row, 0, mWidth, true);
+        while (x < mWidth)
+        {
+            int end = findBit(row, x, mWidth, false);
+            Run run = { x, end - 1, -1 };
+
+            // 8-connected: previous runs overlapping [x0 - 1, x1 + 1]
+            while (p < mPrevRuns.size() && mPrevRuns[p].x1 < run.x0 - 1) p++;
+            for (size_t q = p; q < mPrevRuns.size() && mPrevRuns[q].x0 <= run.x1 + 1; q++)
+            {
+                int other = find(mPrevRuns[q].label);
+                if (run.label < 0) run.label = other;
+                else if (other != run.label)
+                {
+                    int a = std::min(other, run.label), b = std::max(other, run.label);
+                    mParent[b] = a;
+                    run.label = a;
+                }
+            }
+            if (run.label < 0)
+            {
+                run.label = (int)mParent.size();
+                mParent.push_back(run.label);
+                mStats.push_back({ 0, run.x0, y, run.x1, y, 0, 0, 0, 0, 0 });
+            }
+
+            // run moments in closed form
+            Region &s = mStats[run.label];
+            double n = run.x1 - run.x0 + 1;
+            double sx = n * (run.x0 + run.x1) / 2;
+            s.area += (int)n;
+            s.minX = std::min(s.minX, run.x0);
+            s.maxX = std::max(s.maxX, run.x1);
+            s.minY = std::min(s.minY, y);
+            s.maxY = std::max(s.maxY, y);
+            s.sumX += sx;
+            s.sumY += n * y;
+            s.sumXX += sumSquares(run.x1) - sumSquares(run.x0 - 1);
+            s.sumYY += n * y * y;
+            s.sumXY += sx * y;
+
+            mRuns.push_back(run);
+            x = end < mWidth ? findBit(row, end, mWidth, true) : mWidth;
+        }
+        mPrevRuns.swap(mRuns);
+        prevY = y;
+    }
+
+    // fold merged labels into their roots, roots always have the smallest label
+    for (size_t i = 0; i < mParent.size(); i++)
+    {
+        int root = find((int)i);
+        if (root == (int)i) continue;
+        Region &r = mStats[root];
+        const Region &s = mStats[i];
+        r.area += s.area;
+        r.minX = std::min(r.minX, s.minX);
+        r.minY = std::min(r.minY, s.minY);
+        r.maxX = std::max(r.maxX, s.maxX);
+        r.maxY = std::max(r.maxY, s.maxY);
+        r.sumX += s.sumX;
+        r.sumY += s.sumY;
+        r.sumXX += s.sumXX;
+        r.sumYY += s.sumYY;
+        r.sumXY += s.sumXY;
+    }
+    for (size_t i = 0; i < mParent.size(); i++)
+    {
+        if (mParent[i] == (int)i) regions.push_back(mStats[i]);
+    }
+    return regions.size();
+}
+
+void BitRaster::unpack(uint8_t *dst, size_t step, uint8_t value, std::vector<uint8_t> *written) const
+{
+    if (written && (int)written->size() != mHeight) written->assign(mHeight, 1);
+    for (int y = 0; y < mHeight; y++)
+    {
+        uint8_t *out = dst + y * step;
+        if (!mRowUsed[y])
+        {
+            if (written && !(*written)[y]) continue;
+            memset(out, 0, mWidth);
+            if (written) (*written)[y] = 0;
+            continue;
+        }
+        if (written) (*written)[y] = 1;
+        const uint64_t *row = &mWords[y * mStride];
+        for (int i = 0; i < mStride; i++)
+        {
+            int x0 = i * 64, x1 = std::min(x0 + 64, mWidth);
+            uint64_t word = row[i];
+            if (!word)
+            {
+                memset(out + x0, 0, x1 - x0);
+                continue;
+            }
+            for (int x = x0; x < x1; x++, word >>= 1)
+            {
+                out[x] = (word & 1) ? value : 0;
+            }
+        }
+    }
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+// Binary raster with 1 bit per pixel, 64 pixels per word, and a per-row
+// "used" flag so that empty rows cost nothing.
+//
+// dilate() grows every set pixel into a disk: each used row is dilated
+// horizontally with word-wide shifts, one pixel per step, and ORed into the
+// rows whose disk span has that width. label() finds 8-connected regions
+// from the horizontal runs and accumulates their moments in the same sweep.
+class BitRaster
+{
+public:
+    struct Region
+    {
+        int area;
+        int minX, minY, maxX, maxY;
+        double sumX, sumY;
+        double sumXX, sumYY, sumXY;
+    };
+
+    void setup(int width, int height);
+    int getWidth() const { return mWidth; }
+    int getHeight() const { return mHeight; }
+
+    // Only clears the used rows.
+    void clear();
+
+    // Points outside the frame are kept in a list, dilate() draws the part
+    // of their disk that reaches into the frame.
+    void set(int x, int y)
+    {
+        if (x < 0 || y < 0 || x >= mWidth || y >= mHeight)
+        {
+            mOutside.push_back({ x, y });
+            return;
+        }
+        mWords[y * mStride + (x >> 6)] |= uint64_t(1) << (x & 63);
+        mRowUsed[y] = 1;
+    }
+
+    // An outside point is removed once per set().
+    void reset(int x, int y)
+    {
+        if (x < 0 || y < 0 || x >= mWidth || y >= mHeight)
+        {
+            resetOutside(x, y);
+            return;
+        }
+        mWords[y * mStride + (x >> 6)] &= ~(uint64_t(1) << (x & 63));
+    }
+
+    bool get(int x, int y) const
+    {
+        return (mWords[y * mStride + (x >> 6)] >> (x & 63)) & 1;
+    }
+
+    // dst = this dilated by a disk, same pixels as a filled cv::circle of
+    // radius; MiniAreaScanApp --check-bit-raster compares both.
+    void dilate(int radius, BitRaster &dst) const;
+
+    // this = a & b, outside points of a are kept where b is set at the
+    // nearest pixel of the frame.
+    void intersect(const BitRaster &a, const BitRaster &b);
+
+    // 8-connected regions, returns their count.
+    size_t label(std::vector<Region> &regions);
+
+    // 0 / value bytes, e.g. into a cv::Mat1b for display. With written, rows
+    // that are empty now and were already zeroed by the last unpack into the
+    // same dst are skipped; an empty vector means dst content is unknown.
+    void unpack(uint8_t *dst, size_t step, uint8_t value, std::vector<uint8_t> *written = nullptr) const;
+
+private:
+    struct Run
+    {
+        int x0, x1;     // inclusive
+        int label;
+    };
+
+    struct Point
+    {
+        int x, y;
+    };
+
+    int find(int label);
+    void resetOutside(int x, int y);
+    // ORs the span [x0, x1] of row y, clipped to the frame
+    void fillSpan(int x0, int x1, int y);
+
+    int mWidth = 0;
+    int mHeight = 0;
+    int mStride = 0;    // words per row
+    std::vector<uint64_t> mWords;
+    std::vector<uint8_t> mRowUsed;
+    std::vector<Point> mOutside;
+
+    // scratch kept between calls
+    mutable std::vector<uint64_t> mRow, mNext;
+    mutable std::vector<int> mSpans;
+    std::vector<Run> mRuns, mPrevRuns;
+    std::vector<int> mParent;
+    std::vector<Region> mStats;
+};
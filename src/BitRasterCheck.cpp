@@ -0,0 +1,99 @@
+#include "MiniAreaScanApp.h"
+#include "BitRaster.h"
+#include "cinder/Rand.h"
+
+#include <math.h>
+#include <algorithm>
+#include <tuple>
+
+namespace
+{
+    typedef std::tuple<int, int, int, int, int, int, int> RegionKey; // area, bounding box, centroid * 1000
+
+    RegionKey regionKey(int area, int minX, int minY, int maxX, int maxY, double cx, double cy)
+    {
+        return RegionKey(area, minX, minY, maxX, maxY, (int)lround(cx * 1000), (int)lround(cy * 1000));
+    }
+
+    template <typename T, size_t N>
+    T pick(const T (&values)[N])
+    {
+        return values[randInt((uint32_t)N)];
+    }
+}
+
+void MiniAreaScanApp::checkBitRaster()
+{
+    const int kTrials = 500;
+    const int kWidths[] = { 63, 64, 65, 130, 317 };
+    const int kHeights[] = { 1, 7, 64, 211 };
+    const int kRadii[] = { 0, 1, 2, 3, 5, 8, 13, 21, 40, 64, 65, 70 };
+
+    BitRaster points, dilated;
+    vector<BitRaster::Region> regions;
+    vector<RegionKey> expected, actual;
+    cv::Mat1b reference;
+    cv::Mat labels, stats, centroids;
+    int dilateFailures = 0, labelFailures = 0;
+
+    for (int trial = 0; trial < kTrials; trial++)
+    {
+        int width = pick(kWidths);
+        int height = pick(kHeights);
+        int radius = pick(kRadii);
+        int count = randInt(120);
+
+        // brute force: one filled cv::circle per point, clipped to the frame
+        points.setup(width, height);
+        reference = cv::Mat1b::zeros(height, width);
+        for (int i = 0; i < count; i++)
+        {
+            int x = randInt(-radius - 5, width + radius + 5);
+            int y = randInt(-radius - 5, height + radius + 5);
+            points.set(x, y);
+            cv::circle(reference, { x, y }, radius, cv::Scalar(255), -1);
+        }
+        points.dilate(radius, dilated);
+
+        int mismatches = 0;
+        for (int y = 0; y < height; y++)
+        {
+            for (int x = 0; x < width; x++)
+            {
+                if (dilated.get(x, y) != (reference(y, x) != 0)) mismatches++;
+            }
+        }
+        if (mismatches > 0)
+        {
+            CI_LOG_E("dilate " << width << "x" << height << ", " << count << " points, radius " << radius << ": " << mismatches << " pixels differ");
+            dilateFailures++;
+            continue;
+        }
+
+        int labelCount = cv::connectedComponentsWithStats(reference, labels, stats, centroids, 8);
+        expected.clear();
+        for (int i = 1; i < labelCount; i++)
+        {
+            int x = stats.at<int>(i, cv::CC_STAT_LEFT), y = stats.at<int>(i, cv::CC_STAT_TOP);
+            expected.push_back(regionKey(stats.at<int>(i, cv::CC_STAT_AREA), x, y,
+                x + stats.at<int>(i, cv::CC_STAT_WIDTH) - 1, y + stats.at<int>(i, cv::CC_STAT_HEIGHT) - 1,
+                centroids.at<double>(i, 0), centroids.at<double>(i, 1)));
+        }
+        dilated.label(regions);
+        actual.clear();
+        for (const auto &r : regions)
+        {
+            actual.push_back(regionKey(r.area, r.minX, r.minY, r.maxX, r.maxY, r.sumX / r.area, r.sumY / r.area));
+        }
+        std::sort(expected.begin(), expected.end());
+        std::sort(actual.begin(), actual.end());
+        if (expected != actual)
+        {
+            CI_LOG_E("label " << width << "x" << height << ", " << count << " points, radius " << radius << ": "
+                << actual.size() << " regions, connectedComponentsWithStats finds " << expected.size());
+            labelFailures++;
+        }
+    }
+
+    CI_LOG_I("BitRaster check, " << kTrials << " random rasters: " << dilateFailures << " dilate and " << labelFailures << " label mismatches");
+}
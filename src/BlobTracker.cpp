@@ -2,7 +2,6 @@
 #include "point2d.h"
 #include <list>
 #include <functional>
-#include <set>
 
 using std::vector;
 
@@ -31,6 +30,7 @@ BlobFinder::Option::Option()
     sort_func = cmp_blob_area;
     handOnlyMode = false;
     handDistance = 0;
+    outputs = OUTPUT_ALL;
 }
 
 #define CVCONTOUR_APPROX_LEVEL 1 // Approx.threshold - the bigger it is, the simpler is the boundary
@@ -51,7 +51,7 @@ static PointState getPointState(const Point &pt, int width, int height)
     if (pt.x < thresh)
         return NEAR_LEFT;
     if (pt.x > x1 - thresh)
-        return NEAR_LEFT;
+        return NEAR_RIGHT;
     if (pt.y < thresh)
         return NEAR_TOP;
     if (pt.y > height - thresh)
@@ -59,201 +59,316 @@ static PointState getPointState(const Point &pt, int width, int height)
     return NEAR_NOTHING;
 }
 
-vector<Blob> BlobFinder::execute(Mat &img, const BlobFinder::Option &option)
+Blob &BlobList::next()
 {
-    vector<Blob> blobs;
-    static vector<Vec4i> hierarchy;
-    static vector<vector<Point>> contours0;
-    static vector<Point> approx;
+    if (count == items.size()) items.emplace_back();
+    Blob &obj = items[count++];
+    obj.pts.clear();
+    obj.rotBox = RotatedRect();
+    obj.angle = 0;
+    obj.length = 0;
+    obj.isHole = false;
+    return obj;
+}
 
-    findContours(img, contours0, hierarchy, RETR_EXTERNAL /*RETR_TREE*/, CHAIN_APPROX_SIMPLE);
+void BlobFinder::findStats(Mat &img, const BlobFinder::Option &option, BlobList &blobs)
+{
+    blobs.clear();
+    int labels = connectedComponentsWithStats(img, mLabels, mStats, mCentroids, 8, CV_32S);
+    for (int i = 1; i < labels; i++)
+    {
+        int area = mStats.at<int>(i, CC_STAT_AREA);
+        if (area < option.minArea || area > option.maxArea) continue;
+
+        Blob &obj = blobs.next();
+        obj.area = (float)area;
+        obj.box = Rect(mStats.at<int>(i, CC_STAT_LEFT), mStats.at<int>(i, CC_STAT_TOP),
+                       mStats.at<int>(i, CC_STAT_WIDTH), mStats.at<int>(i, CC_STAT_HEIGHT));
+        obj.center.x = (float)mCentroids.at<double>(i, 0);
+        obj.center.y = (float)mCentroids.at<double>(i, 1);
+    }
+}
 
-    for (const auto &contour : contours0)
+void BlobFinder::execute(Mat &img, const BlobFinder::Option &option, BlobList &blobs)
+{
+    // the hand post-processing walks the polygon
+    if (option.outputs == 0 && !option.handOnlyMode)
     {
-        bool isHole = false;
+        findStats(img, option, blobs);
+    }
+    else
+    {
+        blobs.clear();
+        findContours(img, mContours, mHierarchy, RETR_EXTERNAL /*RETR_TREE*/, CHAIN_APPROX_SIMPLE);
 
-        double area = fabs(contourArea(contour));
-        if (area >= option.minArea && area <= option.maxArea)
+        for (const auto &contour : mContours)
         {
-            int length = arcLength(contour, true);
-            if (option.convexHull) //Convex Hull of the segmentation
-                convexHull(contour, approx);
-            else //Polygonal approximation of the segmentation
-                approxPolyDP(contour, approx, std::min<double>(length * 0.003, 2.0), true);
-
-            area = contourArea(approx); //update area
-            Moments mom = moments(approx);
-
-            blobs.push_back({});
-
-            Blob &obj = blobs[blobs.size() - 1];
-            //fill the blob structure
-            obj.area = fabs(area);
-            obj.length = length;
-            obj.isHole = isHole;
-            obj.box = boundingRect(approx);
-            obj.rotBox = minAreaRect(approx);
-            obj.angle = (90 - obj.rotBox.angle) * GRAD_PI2; //in radians
-
-            if (mom.m10 > -DBL_EPSILON && mom.m10 < DBL_EPSILON)
-            {
-                obj.center.x = obj.box.x + obj.box.width / 2;
-                obj.center.y = obj.box.y + obj.box.height / 2;
-            }
-            else
+            bool isHole = false;
+
+            double area = fabs(contourArea(contour));
+            if (area >= option.minArea && area <= option.maxArea)
             {
-                obj.center.x = mom.m10 / mom.m00;
-                obj.center.y = mom.m01 / mom.m00;
-            }
+                int length = arcLength(contour, true);
+                if (option.convexHull) //Convex Hull of the segmentation
+                    convexHull(contour, mApprox);
+                else //Polygonal approximation of the segmentation
+                    approxPolyDP(contour, mApprox, std::min<double>(length * 0.003, 2.0), true);
+
+                area = contourArea(mApprox); //update area
+                Moments mom = moments(mApprox);
+
+                Blob &obj = blobs.next();
+                //fill the blob structure
+                obj.area = fabs(area);
+                obj.length = length;
+                obj.isHole = isHole;
+                obj.box = boundingRect(mApprox);
+                if (option.outputs & OUTPUT_SHAPE)
+                {
+                    obj.rotBox = minAreaRect(mApprox);
+                    obj.angle = (90 - obj.rotBox.angle) * GRAD_PI2; //in radians
+                }
 
-            obj.pts = approx;
+                if (mom.m10 > -DBL_EPSILON && mom.m10 < DBL_EPSILON)
+                {
+                    obj.center.x = obj.box.x + obj.box.width / 2;
+                    obj.center.y = obj.box.y + obj.box.height / 2;
+                }
+                else
+                {
+                    obj.center.x = mom.m10 / mom.m00;
+                    obj.center.y = mom.m01 / mom.m00;
+                }
+
+                if ((option.outputs & OUTPUT_POLYGON) || option.handOnlyMode) obj.pts.assign(mApprox.begin(), mApprox.end());
+            }
+            isHole = true;
         }
-        isHole = true;
+
+        if (option.handOnlyMode) findHands(img, option, blobs);
     }
 
-    const int handRegionDistance = 30;
-    if (option.handOnlyMode)
+    if (!blobs.empty())
+        std::sort(blobs.begin(), blobs.end(), option.sort_func);
+}
+
+void BlobFinder::findHands(Mat &img, const BlobFinder::Option &option, BlobList &blobs)
+{
+    // An arm reaches in from one edge, its tip is the hull point furthest from
+    // that edge; a blob that touches no edge is taken by its point closest to
+    // the center. The tip position is averaged from the contour points next
+    // to it within handDistance, walking at most MAX_TIP_POINTS each way, so
+    // the cost per blob is one hull plus a bounded walk.
+    const int MAX_TIP_POINTS = 32;
+    const float maxDistSq = option.handDistance * option.handDistance;
+
+    for (auto &b : blobs)
     {
-        float real_dist = option.handDistance;
-        real_dist *= real_dist;
+        const int n = (int)b.pts.size();
+        if (n == 0) continue;
+        convexHull(b.pts, mHullIndices, false, false);
 
-        // post-processing for fake hand tracking
-        for (auto &b : blobs)
+        // the edge points of a blob are always on its hull
+        int nearSides = 0;     // bit per PointState
+        for (int idx : mHullIndices)
         {
-            std::set<PointState> NearPointSet;
-
-            vector<Point> new_pts;
-            Point pt_ref(img.cols / 2, img.rows / 2);
+            PointState st = getPointState(b.pts[idx], img.cols, img.rows);
+            if (st != NEAR_NOTHING) nearSides |= 1 << st;
+        }
+        if (nearSides & (nearSides - 1))
+        {
+            // skip blobs that touch multiple sides
+            continue;
+        }
 
-            for (int j = 0; j < b.pts.size(); j++)
+        int tip = mHullIndices.empty() ? 0 : mHullIndices[0];
+        float best = -FLT_MAX;
+        for (int idx : mHullIndices)
+        {
+            const Point &pt = b.pts[idx];
+            float score;
+            switch (nearSides)
             {
-                PointState st = getPointState(b.pts[j], img.cols, img.rows);
-                if (st != NEAR_NOTHING)
-                {
-                    NearPointSet.insert(st);
-                    pt_ref = b.pts[j];
-                    //break;
-                }
-            }
-
-            if (NearPointSet.size() > 1)
+            case 1 << NEAR_LEFT: score = (float)pt.x; break;
+            case 1 << NEAR_RIGHT: score = (float)(img.cols - pt.x); break;
+            case 1 << NEAR_TOP: score = (float)pt.y; break;
+            case 1 << NEAR_BOTTOM: score = (float)(img.rows - pt.y); break;
+            default:
             {
-                // skip blobs that touchs multiple sides
-                continue;
+                float dx = pt.x - img.cols / 2.0f, dy = pt.y - img.rows / 2.0f;
+                score = -(dx * dx + dy * dy);
             }
-            int min_idx = -1;
-            bool only_one_near = NearPointSet.size() == 1;
-            int min_value = only_one_near ? 0 : INT_MAX;
-
-            for (int j = 0; j < b.pts.size(); j++)
+            }
+            if (score > best)
             {
-                Point diff = b.pts[j] - pt_ref;
-                float dist = diff.x * diff.x + diff.y * diff.y;
-
-                if (
-                    (only_one_near && dist > min_value) ||
-                    (!only_one_near && dist < min_value))
-                {
-                    min_value = dist;
-                    min_idx = j;
-                }
+                best = score;
+                tip = idx;
             }
+        }
 
-            int n_neighbors = 1;
-            float sum_x = b.pts[min_idx].x;
-            float sum_y = b.pts[min_idx].y;
-
-            for (int j = 0; j < b.pts.size(); j++)
+        const Point tipPt = b.pts[tip];
+        mHandPts.clear();
+        mHandPts.push_back(tipPt);
+        float sum_x = tipPt.x;
+        float sum_y = tipPt.y;
+        int forward = 0;
+        for (int dir = 1; dir >= -1; dir -= 2)
+        {
+            // the two walks never visit the same point twice
+            int maxSteps = std::min(MAX_TIP_POINTS, n - 1 - (dir < 0 ? forward : 0));
+            for (int step = 1; step <= maxSteps; step++)
             {
-                Point diff = b.pts[j] - b.pts[min_idx];
-                if ((diff.x * diff.x + diff.y * diff.y) < real_dist)
-                {
-                    sum_x += b.pts[j].x;
-                    sum_y += b.pts[j].y;
-                    n_neighbors++;
-                    new_pts.push_back(b.pts[j]);
-                }
+                const Point &pt = b.pts[((tip + dir * step) % n + n) % n];
+                Point diff = pt - tipPt;
+                if (diff.x * diff.x + diff.y * diff.y >= maxDistSq) break;
+                sum_x += pt.x;
+                sum_y += pt.y;
+                mHandPts.push_back(pt);
+                if (dir > 0) forward = step;
             }
-            b.center.x = sum_x / n_neighbors;
-            b.center.y = sum_y / n_neighbors;
-            b.pts = new_pts;
         }
+        b.center.x = sum_x / mHandPts.size();
+        b.center.y = sum_y / mHandPts.size();
+        b.pts.assign(mHandPts.begin(), mHandPts.end());
     }
+}
 
-    if (!blobs.empty())
-        std::sort(blobs.begin(), blobs.end(), option.sort_func);
+void TrackedBlobTable::clear()
+{
+    id.clear();
+    center.clear();
+    velocity.clear();
+    acceleration.clear();
+    angle.clear();
+    angularVelocity.clear();
+    angularAcceleration.clear();
+    area.clear();
+    length.clear();
+    box.clear();
+    rotBox.clear();
+    ptsFirst.clear();
+    ptsCount.clear();
+    pts.clear();
+}
 
-    return blobs;
+size_t TrackedBlobTable::push(const Blob &blob, int blobId)
+{
+    id.push_back(blobId);
+    center.push_back(blob.center);
+    velocity.push_back(Point2f());
+    acceleration.push_back(0);
+    angle.push_back(blob.angle);
+    angularVelocity.push_back(0);
+    angularAcceleration.push_back(0);
+    area.push_back(blob.area);
+    length.push_back(blob.length);
+    box.push_back(blob.box);
+    rotBox.push_back(blob.rotBox);
+    ptsFirst.push_back((uint32_t)pts.size());
+    ptsCount.push_back((uint32_t)blob.pts.size());
+    pts.insert(pts.end(), blob.pts.begin(), blob.pts.end());
+    return id.size() - 1;
+}
+
+size_t TrackedBlobTable::push(const TrackedBlobTable &other, size_t row)
+{
+    id.push_back(other.id[row]);
+    center.push_back(other.center[row]);
+    velocity.push_back(other.velocity[row]);
+    acceleration.push_back(other.acceleration[row]);
+    angle.push_back(other.angle[row]);
+    angularVelocity.push_back(other.angularVelocity[row]);
+    angularAcceleration.push_back(other.angularAcceleration[row]);
+    area.push_back(other.area[row]);
+    length.push_back(other.length[row]);
+    box.push_back(other.box[row]);
+    rotBox.push_back(other.rotBox[row]);
+    ptsFirst.push_back((uint32_t)pts.size());
+    ptsCount.push_back(other.ptsCount[row]);
+    const Point *first = other.pts.data() + other.ptsFirst[row];
+    pts.insert(pts.end(), first, first + other.ptsCount[row]);
+    return id.size() - 1;
 }
 
 BlobTracker::BlobTracker()
 {
     IDCounter = 0;
+    mListener = nullptr;
 }
 
-void BlobTracker::trackBlobs(const vector<Blob> &newBlobs)
+void BlobTracker::trackBlobs(const BlobList &newBlobs)
 {
     deadBlobs.clear();
+    events.clear();
     const int n_old = trackedBlobs.size();
     const int n_new = newBlobs.size();
-    vector<TrackedBlob> newTrackedBlobs(n_new);
-    std::copy(newBlobs.begin(), newBlobs.end(), newTrackedBlobs.begin());
 
-    vector<int> nn_of_a(n_old);   //nearest neighbor of pta in ptb
-    vector<int> dist_of_a(n_old); //nearest neighbor of pta in ptb
-    fill(nn_of_a.begin(), nn_of_a.end(), -1);
-    fill(dist_of_a.begin(), dist_of_a.end(), INT_MAX);
+    mNearest.assign(n_old, -1);         //nearest neighbor of pta in ptb
+    mNearestDist.assign(n_old, INT_MAX);
 
     if (n_old != 0 && n_new != 0)
     {
-        Mat1f ma(trackedBlobs.size(), 2);
-        Mat1f mb(newBlobs.size(), 2);
+        mOld.create(n_old, 2);
+        mNew.create(n_new, 2);
         for (int i = 0; i < n_old; i++)
         {
-            ma(i, 0) = trackedBlobs[i].center.x;
-            ma(i, 1) = trackedBlobs[i].center.y;
+            mOld(i, 0) = trackedBlobs.center[i].x;
+            mOld(i, 1) = trackedBlobs.center[i].y;
         }
         for (int i = 0; i < n_new; i++)
         {
-            mb(i, 0) = newTrackedBlobs[i].center.x;
-            mb(i, 1) = newTrackedBlobs[i].center.y;
+            mNew(i, 0) = newBlobs[i].center.x;
+            mNew(i, 1) = newBlobs[i].center.y;
         }
 
-        BFMatcher matcher(NORM_L2);
-        static vector<DMatch> matches;
-        matcher.match(mb, ma, matches);
-        const int n_matches = matches.size();
+        mMatcher.match(mNew, mOld, mMatches);
+        const int n_matches = mMatches.size();
         for (int i = 0; i < n_matches; i++)
         {
-            const DMatch &match = matches[i];
+            const DMatch &match = mMatches[i];
             int t_id = match.trainIdx;
             int q_id = match.queryIdx;
             float dist = match.distance;
 
             //TODO: 200 -> param
-            if (dist < 200 && dist < dist_of_a[t_id])
+            if (dist < 200 && dist < mNearestDist[t_id])
             {
-                dist_of_a[t_id] = dist;
-                nn_of_a[t_id] = q_id;
+                mNearestDist[t_id] = dist;
+                mNearest[t_id] = q_id;
             }
         }
     }
 
+    // the next table is built from scratch and swapped in, surviving blobs keep their order
+    mNext.clear();
+    mEntering.assign(n_new, 1);
     for (int i = 0; i < n_old; i++)
     {
-        int nn = nn_of_a[i];
+        int nn = mNearest[i];
         if (nn != -1)
         {
             //moving blobs
-            Point2f lastCenter = trackedBlobs[i].center;
-            newTrackedBlobs[nn].id = trackedBlobs[i].id; //save id, cause we will overwrite the data
-            trackedBlobs[i] = newTrackedBlobs[nn];       //update with new data
+            Point2f lastCenter = trackedBlobs.center[i];
+            Point2f lastVelocity = trackedBlobs.velocity[i];
+            float lastAngle = trackedBlobs.angle[i];
+            float lastAngularVelocity = trackedBlobs.angularVelocity[i];
+            size_t k = mNext.push(newBlobs[nn], trackedBlobs.id[i]); //keep the id, take the new data
+            mEntering[nn] = 0;
+            events.push_back({ BlobEvent::BLOB_UPDATED, trackedBlobs.id[i], (int)k, i });
 
             // TODO: ....
-            trackedBlobs[i].velocity.x = trackedBlobs[i].center.x - lastCenter.x;
-            trackedBlobs[i].velocity.y = trackedBlobs[i].center.y - lastCenter.y;
-            float posDelta = sqrtf((trackedBlobs[i].velocity.x * trackedBlobs[i].velocity.x) +
-                                   (trackedBlobs[i].velocity.y * trackedBlobs[i].velocity.y));
+            Point2f &center = mNext.center[k];
+            Point2f &velocity = mNext.velocity[k];
+            velocity.x = center.x - lastCenter.x;
+            velocity.y = center.y - lastCenter.y;
+            float posDelta = sqrtf((velocity.x * velocity.x) + (velocity.y * velocity.y));
+            mNext.acceleration[k] = posDelta - sqrtf(lastVelocity.x * lastVelocity.x + lastVelocity.y * lastVelocity.y);
+
+            // wrap into [-pi, pi) so that crossing the angle range does not look like a full turn
+            float angleDelta = mNext.angle[k] - lastAngle;
+            angleDelta -= floorf(angleDelta / (2 * (float)CV_PI) + 0.5f) * 2 * (float)CV_PI;
+            mNext.angularVelocity[k] = angleDelta;
+            mNext.angularAcceleration[k] = angleDelta - lastAngularVelocity;
 
             // AlexP
             // now, filter the blob position based on MOVEMENT_FILTERING value
@@ -263,28 +378,45 @@ void BlobTracker::trackBlobs(const vector<Blob> &newBlobs)
             // http://www.wolframalpha.com/input/?i=plot+1/exp(x/15)+and+1/exp(x/10)+and+1/exp(x/5)+from+0+to+100
 #define MOVEMENT_FILTERING 2
             float a = 1.0f - 1.0f / expf(posDelta / (1.0f + (float)MOVEMENT_FILTERING * 10));
-            trackedBlobs[i].center.x = a * trackedBlobs[i].center.x + (1 - a) * lastCenter.x;
-            trackedBlobs[i].center.y = a * trackedBlobs[i].center.y + (1 - a) * lastCenter.y;
+            center.x = a * center.x + (1 - a) * lastCenter.x;
+            center.y = a * center.y + (1 - a) * lastCenter.y;
         }
         else
         {
-            deadBlobs.push_back(trackedBlobs[i]);
-            trackedBlobs[i].id = TrackedBlob::BLOB_TO_DELETE;
+            deadBlobs.push(trackedBlobs, i);
+            events.push_back({ BlobEvent::BLOB_REMOVED, trackedBlobs.id[i], -1, i });
         }
     }
-    trackedBlobs.erase(remove_if(trackedBlobs.begin(), trackedBlobs.end(), std::mem_fun_ref(&TrackedBlob::isDead)),
-                       trackedBlobs.end());
     //entering blobs
     for (int i = 0; i < n_new; i++)
     {
-        if (newTrackedBlobs[i].id == TrackedBlob::BLOB_NEW_ID)
+        if (mEntering[i])
         {
             //add new track
 #define MAX_BLOB_ID 1000
             if (IDCounter > MAX_BLOB_ID)
                 IDCounter = 0;
-            newTrackedBlobs[i].id = IDCounter++;
-            trackedBlobs.push_back(newTrackedBlobs[i]);
+            int id = IDCounter++;
+            size_t k = mNext.push(newBlobs[i], id);
+            events.push_back({ BlobEvent::BLOB_ADDED, id, (int)k, -1 });
+        }
+    }
+    std::swap(trackedBlobs, mNext);
+
+    if (!mListener) return;
+    for (const auto &event : events)
+    {
+        switch (event.type)
+        {
+        case BlobEvent::BLOB_ADDED:
+            mListener->blobAdded(trackedBlobs, event.row);
+            break;
+        case BlobEvent::BLOB_UPDATED:
+            mListener->blobUpdated(mNext, event.previousRow, trackedBlobs, event.row);
+            break;
+        case BlobEvent::BLOB_REMOVED:
+            mListener->blobRemoved(mNext, event.previousRow);
+            break;
         }
     }
 }
@@ -10,7 +10,8 @@
 *
 * Based on the trackning it fires events when blobs come into existence,
 * move around, and disappear. The object which receives the callbacks
-* can be specified with setListener().
+* can be specified with setListener(), the same events are kept in the
+* events list until the next frame.
 *
 */
 #pragma once
@@ -47,6 +48,10 @@ struct Blob
         length = b.length;
     }
 
+    // moves keep the pts buffer, e.g. while sorting
+    Blob(Blob &&) = default;
+    Blob &operator = (Blob &&) = default;
+
     Blob(Rect rc, Point ct, float _area = 0, float _angle = 0, bool hole = false)
     {
         box = rc;
@@ -88,44 +93,76 @@ struct Blob
     }
 };
 
-struct TrackedBlob : public Blob
+// Tracked blobs as parallel arrays, row i is one blob. The polygon of row i
+// is pts[ptsFirst[i], ptsFirst[i] + ptsCount[i]) in the point pool shared
+// by all rows. Rows are appended in place, so a table that is cleared and
+// refilled every frame stops allocating once it saw its largest frame.
+struct TrackedBlobTable
 {
-    enum
-    {
-        BLOB_NEW_ID = -3,
-        BLOB_TO_DELETE = -2,
-    };
+    size_t size() const { return id.size(); }
+    bool empty() const { return id.empty(); }
+    void clear();
+
+    // Appends a row with zero velocity, returns its index.
+    size_t push(const Blob &blob, int blobId);
+    size_t push(const TrackedBlobTable &other, size_t row);
+
+    std::vector<int> id;
+    std::vector<Point2f> center;
+    std::vector<Point2f> velocity;
+    std::vector<float> acceleration;        // change of speed since last frame
+    std::vector<float> angle;
+    std::vector<float> angularVelocity;     // radians per frame
+    std::vector<float> angularAcceleration;
+    std::vector<float> area;
+    std::vector<float> length;
+    std::vector<Rect> box;
+    std::vector<RotatedRect> rotBox;
+    std::vector<uint32_t> ptsFirst;
+    std::vector<uint32_t> ptsCount;
+    std::vector<Point> pts;
+};
 
-    int id;
-    Point2f velocity;
+// Blobs of one frame, the first count elements of items. items never
+// shrinks, so a frame with fewer blobs keeps the elements past count, and
+// their pts capacity, for the next frame with more.
+struct BlobList
+{
+    typedef std::vector<Blob>::iterator iterator;
+    typedef std::vector<Blob>::const_iterator const_iterator;
 
-    // Used only by BlobTracker
-    //
-    bool markedForDeletion;
-    int framesLeft;
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    void clear() { count = 0; }
 
-    TrackedBlob() : Blob()
-    {
-        id = BLOB_NEW_ID;
-        markedForDeletion = false;
-        framesLeft = 0;
-    }
+    // Appends an element reset to an empty blob, growing items when needed.
+    Blob &next();
 
-    TrackedBlob(const Blob &b) : Blob(b)
-    {
-        id = BLOB_NEW_ID;
-        markedForDeletion = false;
-        framesLeft = 0;
-    }
+    Blob &operator[](size_t i) { return items[i]; }
+    const Blob &operator[](size_t i) const { return items[i]; }
+    iterator begin() { return items.begin(); }
+    iterator end() { return items.begin() + count; }
+    const_iterator begin() const { return items.begin(); }
+    const_iterator end() const { return items.begin() + count; }
 
-    bool isDead() const
-    {
-        return id == BLOB_TO_DELETE;
-    }
+    std::vector<Blob> items;
+    size_t count = 0;
 };
 
-struct BlobFinder
+// Holds the contour and label buffers between frames, so that a steady
+// scene is processed without allocating. One instance per pipeline; separate
+// instances can run on different threads.
+class BlobFinder
 {
+public:
+    // Blob fields beyond center, area and box, which are always filled.
+    enum Output
+    {
+        OUTPUT_SHAPE = 1,       // rotBox, angle, length
+        OUTPUT_POLYGON = 2,     // pts
+        OUTPUT_ALL = OUTPUT_SHAPE | OUTPUT_POLYGON,
+    };
+
     struct Option
     {
         Option();
@@ -133,21 +170,80 @@ struct BlobFinder
         int maxArea;
         bool convexHull;
         bool(*sort_func)(const Blob &a, const Blob &b);
-        bool handOnlyMode;
-        int handDistance;
+        bool handOnlyMode;      // replace each blob by the tip of an arm reaching in from an edge
+        float handDistance;     // in pixel, contour points this close to the tip make up the hand
+        // Output flags. 0 takes a single connected components pass instead of
+        // tracing contours, area is then the pixel count of the blob rather
+        // than the area of its approximated contour.
+        int outputs;
     };
-    static std::vector<Blob> execute(cv::Mat &src, const Option& option);
+
+    // Replaces the content of blobs, whose elements and pts buffers are reused.
+    void execute(cv::Mat &src, const Option &option, BlobList &blobs);
+
+private:
+    void findStats(cv::Mat &src, const Option &option, BlobList &blobs);
+    void findHands(cv::Mat &src, const Option &option, BlobList &blobs);
+
+    std::vector<cv::Vec4i> mHierarchy;
+    std::vector<std::vector<Point>> mContours;
+    std::vector<Point> mApprox, mHandPts;
+    std::vector<int> mHullIndices;
+    cv::Mat mLabels, mStats, mCentroids;
+};
+
+// One change of the tracked set. row indexes trackedBlobs, previousRow
+// indexes previousBlobs(), -1 where the blob does not exist.
+struct BlobEvent
+{
+    enum Type
+    {
+        BLOB_ADDED,     // row only
+        BLOB_UPDATED,   // both
+        BLOB_REMOVED,   // previousRow only
+    };
+
+    Type type;
+    int id;
+    int row;
+    int previousRow;
+};
+
+class BlobListener
+{
+public:
+    virtual ~BlobListener() {}
+    virtual void blobAdded(const TrackedBlobTable &, size_t) {}
+    virtual void blobUpdated(const TrackedBlobTable &, size_t, const TrackedBlobTable &, size_t) {}
+    virtual void blobRemoved(const TrackedBlobTable &, size_t) {}
 };
 
 class BlobTracker
 {
 public:
     BlobTracker();
-    void trackBlobs(const std::vector<Blob> &newBlobs);
+    void trackBlobs(const BlobList &newBlobs);
+
+    // Called from trackBlobs() for every event, after trackedBlobs was
+    // updated. The listener is not owned, nullptr removes it.
+    void setListener(BlobListener *listener) { mListener = listener; }
+
+    // The table trackedBlobs replaced, valid until the next trackBlobs().
+    const TrackedBlobTable &previousBlobs() const { return mNext; }
 
-    std::vector<TrackedBlob>   trackedBlobs; //tracked blobs
-    std::vector<TrackedBlob>  deadBlobs;
+    TrackedBlobTable trackedBlobs; //tracked blobs
+    TrackedBlobTable deadBlobs;
+    std::vector<BlobEvent> events;  // removed and updated in previous order, then added
 
 private:
     unsigned int                        IDCounter;    //counter of last blob
+    BlobListener *mListener;
+
+    // trackBlobs() scratch, reused across frames
+    TrackedBlobTable mNext;
+    std::vector<uint8_t> mEntering;
+    std::vector<int> mNearest, mNearestDist;
+    std::vector<cv::DMatch> mMatches;
+    cv::Mat1f mOld, mNew;
+    cv::BFMatcher mMatcher{ cv::NORM_L2 };
 };
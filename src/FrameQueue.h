@@ -0,0 +1,210 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <utility>
+
+// Bounded lock-free queue between two pipeline stages.
+//
+// Frames are swapped in and out instead of copied: push() hands back the
+// frame that was last popped from the slot, so the buffers inside T
+// circulate between the stages and a steady pipeline does not allocate.
+// The slots follow Dmitry Vyukov's bounded MPMC queue, which lets the
+// producer drop the oldest frame itself while the consumer pops.
+//
+// Only a stage that has to wait takes a mutex, to sleep until the other
+// side signals; pushing and popping never lock.
+template<typename T>
+class FrameQueue
+{
+public:
+    enum Overflow
+    {
+        OVERFLOW_DROP_OLDEST,   // a full queue drops its oldest frame, the producer never waits
+        OVERFLOW_BLOCK,         // a full queue makes the producer wait for the consumer
+    };
+
+    explicit FrameQueue(size_t capacity, Overflow overflow = OVERFLOW_DROP_OLDEST)
+        : mCapacity(capacity > 0 ? capacity : 1), mSlots(new Slot[mCapacity]), mOverflow(overflow)
+    {
+        for (size_t i = 0; i < mCapacity; i++) mSlots[i].sequence = i;
+    }
+
+    size_t getCapacity() const { return mCapacity; }
+
+    // Takes effect with the next push(), safe to call while running.
+    void setOverflow(Overflow overflow) { mOverflow = overflow; }
+
+    // Swaps frame into the queue, frame receives a recycled one. Returns
+    // false without touching frame once the queue is closed.
+    bool push(T &frame)
+    {
+        while (!tryPush(frame))
+        {
+            if (mClosed) return false;
+            if (mOverflow == OVERFLOW_DROP_OLDEST)
+            {
+                // per producer thread, so that several producers can drop at once
+                static thread_local T dropped;
+                if (tryPop(dropped)) mDropCount++;
+                continue;
+            }
+            mNotFull.wait([this] { return mClosed || !isFull(); });
+        }
+        return true;
+    }
+
+    // Waits for the oldest frame and swaps it into frame. Returns false
+    // once the queue is closed and empty.
+    bool pop(T &frame)
+    {
+        while (!tryPop(frame))
+        {
+            if (mClosed) return false;
+            mNotEmpty.wait([this] { return mClosed || !isEmpty(); });
+        }
+        return true;
+    }
+
+    bool tryPush(T &frame)
+    {
+        if (!enqueue(frame)) return false;
+        mNotEmpty.notify();
+        return true;
+    }
+
+    bool tryPop(T &frame)
+    {
+        if (!dequeue(frame)) return false;
+        mNotFull.notify();
+        return true;
+    }
+
+    // Wakes up both sides for good, e.g. before joining the stage threads.
+    void close()
+    {
+        mClosed = true;
+        mNotEmpty.notify();
+        mNotFull.notify();
+    }
+
+    // Reopens a closed queue, the frames still in it are kept.
+    void open() { mClosed = false; }
+
+    // Frames dropped by OVERFLOW_DROP_OLDEST since the start.
+    uint64_t getDropCount() const { return mDropCount; }
+
+private:
+    struct Slot
+    {
+        std::atomic<size_t> sequence;
+        T frame;
+    };
+
+    // Sleeps until ready() holds, without a lost wakeup: the waiter
+    // announces itself before checking again, and notify() checks for
+    // waiters after the queue state changed.
+    struct Signal
+    {
+        template<typename Ready>
+        void wait(Ready ready)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            waiters++;
+            condition.wait(lock, ready);
+            waiters--;
+        }
+
+        void notify()
+        {
+            // orders the slot store of push / pop before the waiters load
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (waiters == 0) return;
+            std::lock_guard<std::mutex> lock(mutex);
+            condition.notify_all();
+        }
+
+        std::mutex mutex;
+        std::condition_variable condition;
+        std::atomic<int> waiters{ 0 };
+    };
+
+    bool enqueue(T &frame)
+    {
+        size_t pos = mTail.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Slot &slot = mSlots[pos % mCapacity];
+            size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+            if (diff == 0)
+            {
+                if (mTail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            }
+            else if (diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = mTail.load(std::memory_order_relaxed);
+            }
+        }
+        Slot &slot = mSlots[pos % mCapacity];
+        std::swap(slot.frame, frame);
+        slot.sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool dequeue(T &frame)
+    {
+        size_t pos = mHead.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Slot &slot = mSlots[pos % mCapacity];
+            size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)sequence - (intptr_t)(pos + 1);
+            if (diff == 0)
+            {
+                if (mHead.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            }
+            else if (diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = mHead.load(std::memory_order_relaxed);
+            }
+        }
+        Slot &slot = mSlots[pos % mCapacity];
+        std::swap(slot.frame, frame);
+        slot.sequence.store(pos + mCapacity, std::memory_order_release);
+        return true;
+    }
+
+    bool isEmpty() const
+    {
+        size_t pos = mHead.load();
+        return mSlots[pos % mCapacity].sequence.load() != pos + 1;
+    }
+
+    bool isFull() const
+    {
+        size_t pos = mTail.load();
+        return mSlots[pos % mCapacity].sequence.load() != pos;
+    }
+
+    const size_t mCapacity;
+    std::unique_ptr<Slot[]> mSlots;
+    std::atomic<size_t> mHead{ 0 };
+    std::atomic<size_t> mTail{ 0 };
+    std::atomic<Overflow> mOverflow;
+    std::atomic<bool> mClosed{ false };
+    std::atomic<uint64_t> mDropCount{ 0 };
+
+    Signal mNotEmpty, mNotFull;
+};
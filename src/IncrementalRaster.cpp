@@ -0,0 +1,141 @@
+#include "IncrementalRaster.h"
+#include "opencv2/imgproc/imgproc.hpp"
+
+#include <stdlib.h>
+#include <algorithm>
+
+void IncrementalRaster::bucket(const std::vector<cv::Point> &points, std::vector<cv::Point> &sorted,
+                               std::vector<int> &offsets)
+{
+    // counting sort by tile, points outside the raster go to the border tiles
+    const int tileCount = mTilesX * mTilesY;
+    auto tileOf = [this](const cv::Point &pt) {
+        int tx = std::min(std::max(pt.x, 0) / TILE_SIZE, mTilesX - 1);
+        int ty = std::min(std::max(pt.y, 0) / TILE_SIZE, mTilesY - 1);
+        return ty * mTilesX + tx;
+    };
+
+    offsets.assign(tileCount + 1, 0);
+    for (const auto &pt : points) offsets[tileOf(pt) + 1]++;
+    for (int t = 0; t < tileCount; t++) offsets[t + 1] += offsets[t];
+
+    mCounts.assign(offsets.begin(), offsets.end() - 1);
+    sorted.resize(points.size());
+    for (const auto &pt : points) sorted[mCounts[tileOf(pt)]++] = pt;
+}
+
+bool IncrementalRaster::tileChanged(int tile, float tolerance) const
+{
+    int first = mCurrentOffsets[tile], count = mCurrentOffsets[tile + 1] - first;
+    int drawnFirst = mDrawnOffsets[tile];
+    if (count != mDrawnOffsets[tile + 1] - drawnFirst) return true;
+    for (int i = 0; i < count; i++)
+    {
+        const cv::Point &a = mCurrent[first + i], &b = mDrawn[drawnFirst + i];
+        if (abs(a.x - b.x) > tolerance || abs(a.y - b.y) > tolerance) return true;
+    }
+    return false;
+}
+
+cv::Rect IncrementalRaster::tileBounds(const std::vector<cv::Point> &sorted, const std::vector<int> &offsets, int tile) const
+{
+    int first = offsets[tile], last = offsets[tile + 1];
+    if (first == last) return cv::Rect();
+    int x1 = sorted[first].x, y1 = sorted[first].y, x2 = x1, y2 = y1;
+    for (int i = first + 1; i < last; i++)
+    {
+        x1 = std::min(x1, sorted[i].x);
+        y1 = std::min(y1, sorted[i].y);
+        x2 = std::max(x2, sorted[i].x);
+        y2 = std::max(y2, sorted[i].y);
+    }
+    int r = std::max(mDiffRadius, mHasFront ? mFrontRadius : 0) + 1;
+    return cv::Rect(x1 - r, y1 - r, x2 - x1 + 2 * r + 1, y2 - y1 + 2 * r + 1) & cv::Rect(0, 0, mWidth, mHeight);
+}
+
+void IncrementalRaster::drawDisk(const cv::Point &pt, cv::Mat1b &diff, cv::Mat1b *front) const
+{
+    cv::circle(diff, pt, mDiffRadius, cv::Scalar(255), -1);
+    if (front) cv::circle(*front, pt, mFrontRadius, cv::Scalar(255), -1);
+}
+
+void IncrementalRaster::draw(const std::vector<cv::Point> &points, cv::Mat1b &diff, int diffRadius,
+                             cv::Mat1b *front, int frontRadius, float tolerance)
+{
+    if (diff.cols != mWidth || diff.rows != mHeight || diffRadius != mDiffRadius
+        || (front != nullptr) != mHasFront || (front && frontRadius != mFrontRadius))
+    {
+        mValid = false;
+    }
+    mWidth = diff.cols;
+    mHeight = diff.rows;
+    mTilesX = (mWidth + TILE_SIZE - 1) / TILE_SIZE;
+    mTilesY = (mHeight + TILE_SIZE - 1) / TILE_SIZE;
+    mDiffRadius = diffRadius;
+    mFrontRadius = frontRadius;
+    mHasFront = front != nullptr;
+    const int tileCount = mTilesX * mTilesY;
+
+    bucket(points, mCurrent, mCurrentOffsets);
+
+    mDirty.clear();
+    mChanged.assign(tileCount, 1);
+    if (!mValid)
+    {
+        diff.setTo(cv::Scalar(0));
+        if (front) front->setTo(cv::Scalar(0));
+    }
+    else
+    {
+        for (int t = 0; t < tileCount; t++)
+        {
+            mChanged[t] = tolerance < 0 || tileChanged(t, tolerance);
+            if (!mChanged[t]) continue;
+            // old disks to erase and new ones to paint
+            cv::Rect before = tileBounds(mDrawn, mDrawnOffsets, t);
+            cv::Rect after = tileBounds(mCurrent, mCurrentOffsets, t);
+            cv::Rect rc = before.area() == 0 ? after : after.area() == 0 ? before : (before | after);
+            if (rc.area() > 0) mDirty.push_back(rc);
+        }
+        if (mDirty.empty()) return;
+
+        // only what was painted before needs clearing
+        for (const auto &rc : mDirty)
+        {
+            diff(rc).setTo(cv::Scalar(0));
+            if (front) (*front)(rc).setTo(cv::Scalar(0));
+        }
+    }
+
+    // unchanged tiles keep the positions already on screen
+    const bool redrawAll = !mValid || mDirty.size() > MAX_DIRTY_RECTS;
+    const int r = std::max(mDiffRadius, mHasFront ? mFrontRadius : 0);
+    mNextDrawn.clear();
+    mNextOffsets.assign(tileCount + 1, 0);
+    for (int t = 0; t < tileCount; t++)
+    {
+        const std::vector<cv::Point> &src = mChanged[t] ? mCurrent : mDrawn;
+        const std::vector<int> &offsets = mChanged[t] ? mCurrentOffsets : mDrawnOffsets;
+        for (int i = offsets[t]; i < offsets[t + 1]; i++)
+        {
+            const cv::Point &pt = src[i];
+            mNextDrawn.push_back(pt);
+            if (redrawAll)
+            {
+                drawDisk(pt, diff, front);
+                continue;
+            }
+            cv::Rect disk(pt.x - r, pt.y - r, 2 * r + 1, 2 * r + 1);
+            for (const auto &rc : mDirty)
+            {
+                if ((disk & rc).area() == 0) continue;
+                drawDisk(pt, diff, front);
+                break;
+            }
+        }
+        mNextOffsets[t + 1] = (int)mNextDrawn.size();
+    }
+    mDrawn.swap(mNextDrawn);
+    mDrawnOffsets.swap(mNextOffsets);
+    mValid = true;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+
+#include "opencv2/core/core.hpp"
+
+// Draws a filled disk per point into diffMat (and optionally frontMat) and
+// keeps what it drew, bucketed in 64x64 pixel tiles. On the next frame only
+// the tiles whose points moved by more than the tolerance are cleared, and
+// only the disks that touch those dirty rectangles are redrawn. Tiles rather
+// than angular sectors so that it also works on clouds fused from several
+// lidars.
+class IncrementalRaster
+{
+public:
+    // Makes the next draw() clear and redraw everything.
+    void reset() { mValid = false; }
+
+    // tolerance in pixel, negative to redraw every disk (still only clearing
+    // what was painted before).
+    void draw(const std::vector<cv::Point> &points, cv::Mat1b &diff, int diffRadius,
+              cv::Mat1b *front, int frontRadius, float tolerance);
+
+private:
+    enum
+    {
+        TILE_SIZE = 64,
+        MAX_DIRTY_RECTS = 32,   // beyond that every disk is redrawn
+    };
+
+    void bucket(const std::vector<cv::Point> &points, std::vector<cv::Point> &sorted, std::vector<int> &offsets);
+    bool tileChanged(int tile, float tolerance) const;
+    cv::Rect tileBounds(const std::vector<cv::Point> &sorted, const std::vector<int> &offsets, int tile) const;
+    void drawDisk(const cv::Point &pt, cv::Mat1b &diff, cv::Mat1b *front) const;
+
+    bool mValid = false;
+    int mWidth = 0, mHeight = 0;
+    int mTilesX = 0, mTilesY = 0;
+    int mDiffRadius = 0, mFrontRadius = 0;
+    bool mHasFront = false;
+
+    std::vector<cv::Point> mDrawn, mCurrent, mNextDrawn;
+    std::vector<int> mDrawnOffsets, mCurrentOffsets, mNextOffsets;
+    std::vector<int> mCounts;
+    std::vector<cv::Rect> mDirty;
+    std::vector<unsigned char> mChanged;
+};
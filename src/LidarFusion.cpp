@@ -0,0 +1,346 @@
+#include "LidarFusion.h"
+#include "Trace.h"
+#include "AllocCounter.h"
+#include "PipelineStage.h"
+#include "AsyncLog.h"
+
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+    uint64_t nowUs()
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+}
+
+LidarFusion::Option::Option()
+{
+    cellSize = 0;
+    maxSkewMs = 100;
+}
+
+LidarFusion::~LidarFusion()
+{
+    stop();
+}
+
+void LidarFusion::addDevice(std::unique_ptr<LidarDevice> device, const std::string &port, const LidarPose &pose)
+{
+    std::unique_ptr<Source> source(new Source());
+    source->device = std::move(device);
+    source->port = port;
+    source->pose = pose;
+    source->status = source->device->status;
+    source->device->setThreadOption(mThreadOption);
+    mSources.push_back(std::move(source));
+    if (mRunning)
+    {
+        Source *s = mSources.back().get();
+        s->thread = std::thread(&LidarFusion::run, this, s);
+        if (mAffinity != 0) setThreadAffinity(s->thread, mAffinity);
+    }
+}
+
+void LidarFusion::clear()
+{
+    stop();
+    mSources.clear();
+}
+
+void LidarFusion::start()
+{
+    if (mRunning) return;
+    mRunning = true;
+    for (auto &source : mSources)
+    {
+        source->thread = std::thread(&LidarFusion::run, this, source.get());
+        if (mAffinity != 0) setThreadAffinity(source->thread, mAffinity);
+    }
+}
+
+void LidarFusion::stop()
+{
+    if (!mRunning) return;
+    mRunning = false;
+    for (auto &source : mSources)
+    {
+        if (source->thread.joinable()) source->thread.join();
+    }
+}
+
+void LidarFusion::reconnect()
+{
+    bool running = mRunning;
+    stop();
+    for (auto &source : mSources)
+    {
+        source->device->setup(source->port);
+        std::lock_guard<std::mutex> lock(source->mutex);
+        source->status = source->device->status;
+    }
+    if (running) start();
+}
+
+std::string LidarFusion::getStatus() const
+{
+    std::string status;
+    for (const auto &source : mSources)
+    {
+        std::lock_guard<std::mutex> lock(source->mutex);
+        if (!status.empty()) status += " | ";
+        status += source->status;
+    }
+    return status;
+}
+
+LidarPose LidarFusion::getPose(size_t index) const
+{
+    std::lock_guard<std::mutex> lock(mSources[index]->mutex);
+    return mSources[index]->pose;
+}
+
+void LidarFusion::setPose(size_t index, const LidarPose &pose)
+{
+    std::lock_guard<std::mutex> lock(mSources[index]->mutex);
+    mSources[index]->pose = pose;
+}
+
+void LidarFusion::setArea(const AreaMask &area)
+{
+    std::lock_guard<std::mutex> lock(mAreaMutex);
+    mArea = area;
+    mAreaVersion++;
+}
+
+void LidarFusion::setAffinity(uint64_t cpuMask)
+{
+    if (mAffinity.exchange(cpuMask) == cpuMask || !mRunning) return;
+    for (auto &source : mSources)
+    {
+        setThreadAffinity(source->thread, cpuMask);
+    }
+}
+
+void LidarFusion::setThreadOption(const LidarThreadOption &option)
+{
+    mThreadOption = option;
+    for (auto &source : mSources)
+    {
+        if (!mRunning)
+        {
+            if (!source->device->setThreadOption(option)) ASYNC_LOG_W("%s: lidar thread scheduling denied", source->port.c_str());
+            continue;
+        }
+        std::lock_guard<std::mutex> lock(source->mutex);
+        source->threadOption = option;
+        source->threadOptionPending = true;
+    }
+}
+
+bool LidarFusion::getPacketJitter(size_t index, LidarPacketJitter &jitter)
+{
+    Source &source = *mSources[index];
+    if (!mRunning) return source.device->getPacketJitter(jitter);
+
+    std::lock_guard<std::mutex> lock(source.mutex);
+    source.jitterRequested = true;
+    if (!source.hasJitter) return false;
+    jitter = source.jitter;
+    source.hasJitter = false;
+    return true;
+}
+
+void LidarFusion::serveRequests(Source *source)
+{
+    LidarThreadOption threadOption;
+    bool threadOptionPending, jitterRequested;
+    {
+        std::lock_guard<std::mutex> lock(source->mutex);
+        threadOption = source->threadOption;
+        threadOptionPending = source->threadOptionPending;
+        jitterRequested = source->jitterRequested;
+        source->threadOptionPending = false;
+        source->jitterRequested = false;
+    }
+    if (threadOptionPending && !source->device->setThreadOption(threadOption))
+    {
+        ASYNC_LOG_W("%s: lidar thread scheduling denied", source->port.c_str());
+    }
+    if (jitterRequested)
+    {
+        LidarPacketJitter jitter;
+        bool hasJitter = source->device->getPacketJitter(jitter);
+        std::lock_guard<std::mutex> lock(source->mutex);
+        source->jitter = jitter;
+        source->hasJitter = hasJitter;
+    }
+}
+
+void LidarFusion::setFilterOption(const ScanFilter::Option &option)
+{
+    std::lock_guard<std::mutex> lock(mFilterMutex);
+    mFilterOption = option;
+}
+
+bool LidarFusion::copyLatestScan(size_t index, std::vector<LidarScanPoint> &scan, uint64_t *sequence) const
+{
+    const Source &source = *mSources[index];
+    std::lock_guard<std::mutex> lock(source.mutex);
+    if (source.latest < 0) return false;
+    scan = source.scans[source.latest].points;
+    if (sequence) *sequence = source.sequence;
+    return true;
+}
+
+void LidarFusion::run(Source *source)
+{
+    TRACE_THREAD_NAME("lidar acquisition");
+    while (mRunning)
+    {
+        ALLOC_STAGE(STAGE_ACQUISITION);
+        serveRequests(source);
+        bool updated = source->device->update();
+        {
+            std::lock_guard<std::mutex> lock(source->mutex);
+            source->status = source->device->status;
+        }
+        if (!updated)
+        {
+            // not connected or no scan yet, don't spin
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            continue;
+        }
+
+        uint64_t timestampUs = nowUs();
+        ScanFilter::Option filterOption;
+        {
+            std::lock_guard<std::mutex> lock(mFilterMutex);
+            filterOption = mFilterOption;
+        }
+        source->filter.apply(source->device->scanData, filterOption);
+
+        std::lock_guard<std::mutex> lock(source->mutex);
+        int next = source->latest == 0 ? 1 : 0;
+        source->scans[next].points.assign(source->device->scanData.begin(), source->device->scanData.end());
+        source->scans[next].timestampUs = timestampUs;
+        source->latest = next;
+        source->sequence++;
+    }
+}
+
+bool LidarFusion::fuse(std::vector<cv::Point2f> &worldPoints, const Option &option, uint64_t *captureUs)
+{
+    TRACE_SCOPE("LidarFusion::fuse");
+    ALLOC_STAGE(STAGE_DETECTION);
+
+    const uint64_t maxSkewUs = (uint64_t)(option.maxSkewMs * 1000);
+    bool hasNewScan = false;
+    uint64_t newestUs = 0;
+    for (auto &source : mSources)
+    {
+        std::lock_guard<std::mutex> lock(source->mutex);
+        if (source->latest < 0) continue;
+        newestUs = std::max(newestUs, source->scans[source->latest].timestampUs);
+        hasNewScan |= source->sequence != source->consumedSequence;
+    }
+    if (!hasNewScan) return false;
+
+    // The oldest latest scan that is still recent is the reference: the other
+    // devices scanned after it, so their previous scan may be nearer to it.
+    uint64_t referenceUs = newestUs;
+    for (auto &source : mSources)
+    {
+        std::lock_guard<std::mutex> lock(source->mutex);
+        if (source->latest < 0) continue;
+        uint64_t latestUs = source->scans[source->latest].timestampUs;
+        if (newestUs - latestUs <= maxSkewUs) referenceUs = std::min(referenceUs, latestUs);
+    }
+
+    // recompile outdated masks without holding the source or the area lock,
+    // the masks belong to fuse() and the acquisition threads keep running
+    for (auto &source : mSources)
+    {
+        LidarPose pose;
+        {
+            std::lock_guard<std::mutex> lock(source->mutex);
+            pose = source->pose;
+        }
+        if (source->maskVersion == mAreaVersion && source->maskPose.x == pose.x
+            && source->maskPose.y == pose.y && source->maskPose.angle == pose.angle) continue;
+
+        TRACE_SCOPE("PolarMask::compile");
+        AreaMask area;
+        int version;
+        {
+            std::lock_guard<std::mutex> lock(mAreaMutex);
+            area = mArea;
+            version = mAreaVersion;
+        }
+        PolarMask mask;
+        mask.compile(area, pose);
+        std::swap(source->mask, mask);
+        source->maskPose = pose;
+        source->maskVersion = version;
+    }
+
+    const float invCell = option.cellSize > 0 ? 1 / option.cellSize : 0;
+    uint64_t usedUs = 0;
+    mTagged.clear();
+    for (int d = 0; d < (int)mSources.size(); d++)
+    {
+        Source &source = *mSources[d];
+        std::lock_guard<std::mutex> lock(source.mutex);
+        if (source.latest < 0) continue;
+        source.consumedSequence = source.sequence;
+
+        // pick whichever of the last two scans is nearer to the reference time
+        const Scan *scan = &source.scans[source.latest];
+        const Scan &previous = source.scans[1 - source.latest];
+        auto distanceUs = [referenceUs](uint64_t us) { return us > referenceUs ? us - referenceUs : referenceUs - us; };
+        if (previous.timestampUs > 0 && distanceUs(previous.timestampUs) < distanceUs(scan->timestampUs))
+        {
+            scan = &previous;
+        }
+        if (distanceUs(scan->timestampUs) > maxSkewUs) continue;
+        usedUs = std::max(usedUs, scan->timestampUs);
+
+        // the pose the mask was compiled for, a newer one applies from the next frame
+        float poseRad = source.maskPose.angle * (float)CV_PI / 180;
+        for (const auto &scanPoint : scan->points)
+        {
+            if (!scanPoint.valid || !source.mask.accepts(scanPoint.angle, scanPoint.dist)) continue;
+            float rad = scanPoint.angle * (float)CV_PI / 180 - poseRad;
+            cv::Point2f pt(source.maskPose.x + sinf(rad) * scanPoint.dist, source.maskPose.y + cosf(rad) * scanPoint.dist);
+            int64_t cx = (int64_t)floorf(pt.x * invCell);
+            int64_t cy = (int64_t)floorf(pt.y * invCell);
+            mTagged.push_back({ (cx << 32) ^ (cy & 0xffffffff), scanPoint.dist, d, pt });
+        }
+    }
+
+    if (captureUs) *captureUs = usedUs;
+
+    worldPoints.clear();
+    if (mSources.size() < 2 || invCell == 0)
+    {
+        for (const auto &tagged : mTagged) worldPoints.push_back(tagged.pt);
+        return true;
+    }
+
+    // In overlap zones several devices see the same surface: for each cell keep
+    // the points of the device with the nearest sample, whose range and angle
+    // errors are the smallest there, so overlaps do not get denser than the rest.
+    std::sort(mTagged.begin(), mTagged.end(), [](const TaggedPoint &a, const TaggedPoint &b) {
+        return a.cell < b.cell || (a.cell == b.cell && a.dist < b.dist);
+    });
+    int nearest = -1;
+    for (size_t i = 0; i < mTagged.size(); i++)
+    {
+        if (i == 0 || mTagged[i].cell != mTagged[i - 1].cell) nearest = mTagged[i].device;
+        if (mTagged[i].device == nearest) worldPoints.push_back(mTagged[i].pt);
+    }
+    return true;
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "opencv2/core/core.hpp"
+#include "../LidarDevice/LidarDevice.h"
+#include "PolarMask.h"
+#include "ScanFilter.h"
+
+// Extrinsic pose of a lidar in the shared world frame, in the same
+// convention as BASE_ANGLE: a scan point at angle a ends up at world
+// angle (a - angle) around the device position (x, y).
+struct LidarPose
+{
+    float x, y;     // millimeter, x to the right, y forward
+    float angle;    // degree
+};
+
+// Runs several lidars, each on its own acquisition thread, and merges their
+// latest scans into one point set in world coordinates.
+class LidarFusion
+{
+public:
+    struct Option
+    {
+        Option();
+        float cellSize;     // millimeter, 0 keeps every point, otherwise a cell seen by several devices keeps the points of the nearest one
+        float maxSkewMs;    // scans further than this from the reference time are skipped
+    };
+
+    ~LidarFusion();
+
+    void addDevice(std::unique_ptr<LidarDevice> device, const std::string &port, const LidarPose &pose);
+    void clear();
+    size_t getDeviceCount() const { return mSources.size(); }
+
+    void start();
+    void stop();
+    // Calls setup() on every device again, e.g. after unplugging one.
+    void reconnect();
+
+    std::string getStatus() const;
+
+    LidarPose getPose(size_t index) const;
+    // Takes effect with the next fuse() call, safe to call while running.
+    void setPose(size_t index, const LidarPose &pose);
+
+    // Copies the latest scan of one device in its own frame. sequence
+    // increments with every scan. Returns false until a first scan arrived.
+    bool copyLatestScan(size_t index, std::vector<LidarScanPoint> &scan, uint64_t *sequence) const;
+
+    // Points outside the area are dropped per device in polar coordinates,
+    // before they are projected. Safe to call while fuse() runs on another thread.
+    void setArea(const AreaMask &area);
+
+    // CPUs of the acquisition threads, see setThreadAffinity().
+    void setAffinity(uint64_t cpuMask);
+
+    // Scheduling of the SDK threads that read the devices, also applied to
+    // devices added later. While running, each acquisition thread applies it
+    // between two scans and logs when the system denied a setting.
+    void setThreadOption(const LidarThreadOption &option);
+
+    // Packet arrival of one device. While running, the acquisition thread
+    // queries the device on request, so this returns what it measured up to
+    // the previous call.
+    bool getPacketJitter(size_t index, LidarPacketJitter &jitter);
+
+    // Applied to every scan on its acquisition thread, before fuse() sees it.
+    void setFilterOption(const ScanFilter::Option &option);
+
+    // Fills worldPoints (millimeter) from the latest scans, aligned to the
+    // oldest latest scan among the devices within maxSkewMs of the newest:
+    // devices that scanned since then contribute whichever of their last two
+    // scans is nearer to it. Returns false when no device delivered a new scan
+    // since the last call. captureUs receives the steady clock time of the
+    // newest scan used.
+    bool fuse(std::vector<cv::Point2f> &worldPoints, const Option &option, uint64_t *captureUs = nullptr);
+
+private:
+    struct Scan
+    {
+        std::vector<LidarScanPoint> points;
+        uint64_t timestampUs = 0;
+    };
+
+    struct Source
+    {
+        std::unique_ptr<LidarDevice> device;
+        std::string port;
+        LidarPose pose;
+        std::thread thread;
+
+        // only used by fuse()
+        PolarMask mask;
+        LidarPose maskPose;
+        int maskVersion = -1;
+
+        mutable std::mutex mutex;
+        std::string status;     // copy of device->status, which the acquisition thread writes
+        Scan scans[2];          // the two latest scans, for time alignment
+        int latest = -1;
+        uint64_t sequence = 0;
+        uint64_t consumedSequence = 0;
+
+        // Requests of the main thread, served by the acquisition thread
+        // between two update() calls, so the device is only used by one thread.
+        LidarThreadOption threadOption;
+        bool threadOptionPending = false;
+        bool jitterRequested = false;
+        bool hasJitter = false;
+        LidarPacketJitter jitter;
+
+        // only used by the acquisition thread
+        ScanFilter filter;
+    };
+
+    struct TaggedPoint
+    {
+        int64_t cell;
+        float dist;     // from its device
+        int device;
+        cv::Point2f pt;
+    };
+
+    void run(Source *source);
+    void serveRequests(Source *source);
+
+    std::vector<std::unique_ptr<Source>> mSources;
+    std::atomic<bool> mRunning{ false };
+    std::atomic<uint64_t> mAffinity{ 0 };
+    LidarThreadOption mThreadOption;
+
+    std::mutex mAreaMutex;
+    AreaMask mArea;
+
+    std::mutex mFilterMutex;
+    ScanFilter::Option mFilterOption;
+    std::atomic<int> mAreaVersion{ 0 };
+
+    // fuse() scratch, reused across frames
+    std::vector<TaggedPoint> mTagged;
+};
@@ -1,6 +1,10 @@
 #include "MiniAreaScanApp.h"
 
 #include "Cinder-VNM/include/MiniConfig.h"
+#include "Trace.h"
+#include "AsyncLog.h"
+
+#include <signal.h>
 
 using namespace std;
 using namespace ci;
@@ -37,11 +41,7 @@ void MiniAreaScanApp::resize()
     }
 
     mParams->setPosition(mLayout.canvases[1].getUpperLeft());
-
-    mFrontMat = cv::Mat1b(APP_HEIGHT, APP_WIDTH);
-    mDiffMat = cv::Mat1b(APP_HEIGHT, APP_WIDTH);
-    mFrontSurface = Channel(APP_WIDTH, APP_HEIGHT, mFrontMat.step, 1, mFrontMat.ptr());
-    mDiffSurface = Channel(APP_WIDTH, APP_HEIGHT, mDiffMat.step, 1, mDiffMat.ptr());
+    // the detection stage picks up the new raster size from update()
 }
 
 void MiniAreaScanApp::draw()
@@ -63,7 +63,7 @@ void MiniAreaScanApp::draw()
         gl::ScopedTextureBind tex2(mDiffTexture);
         gl::drawSolidRect(mLayout.canvases[2]);
     }
-    visualizeBlobs(mBlobTracker);
+    visualizeBlobs(mDisplayFrame.blobs);
 }
 
 void MiniAreaScanApp::keyUp(KeyEvent event)
@@ -73,9 +73,86 @@ void MiniAreaScanApp::keyUp(KeyEvent event)
     {
         quit();
     }
+#if defined(MINIAREASCAN_TRACE)
+    else if (code == KeyEvent::KEY_t)
+    {
+        mTraceFlushRequested = true;
+    }
+#endif
+}
+
+#if defined(MINIAREASCAN_TRACE)
+static volatile sig_atomic_t sTraceFlushSignaled = 0;
+
+static void onTraceFlushSignal(int)
+{
+    sTraceFlushSignaled = 1;
+}
+
+void MiniAreaScanApp::setupTrace()
+{
+    TRACE_THREAD_NAME("main");
+#if !defined(_WIN32)
+    // kill -USR1 <pid> dumps the trace when running without a usable window
+    signal(SIGUSR1, onTraceFlushSignal);
+#endif
 }
 
-void MiniAreaScanApp::visualizeBlobs(const BlobTracker &blobTracker)
+void MiniAreaScanApp::updateTrace()
+{
+    trace::setEnabled(TRACE_ENABLED);
+
+    if (!mTraceFlushRequested && !sTraceFlushSignaled) return;
+    mTraceFlushRequested = false;
+    sTraceFlushSignaled = 0;
+
+    char name[64];
+    sprintf(name, "trace-%u.json", getElapsedFrames());
+    auto path = getAppPath() / name;
+    int count = trace::flush(path.string().c_str());
+    CI_LOG_I("Trace: " << count << " events written to " << path);
+}
+#endif
+
+#if defined(MINIAREASCAN_ALLOC_COUNTER)
+void MiniAreaScanApp::updateAllocCheck()
+{
+    if (!mAllocCheck) return;
+
+    // counted in scans that went through every stage, not in displayed frames
+    int scans = mAllocScans;
+    if (scans <= ALLOC_CHECK_WARMUP) return;
+
+    const alloc::Stage stages[] = { alloc::STAGE_ACQUISITION, alloc::STAGE_DETECTION, alloc::STAGE_TRACKING, alloc::STAGE_OUTPUT };
+    if (mAllocStartScan < 0)
+    {
+        for (auto stage : stages) mAllocBaseline[stage] = alloc::getStageCounts(stage).allocs;
+        mAllocStartScan = scans;
+        return;
+    }
+
+    bool failed = false;
+    for (auto stage : stages)
+    {
+        alloc::Counts counts = alloc::getStageCounts(stage);
+        if (counts.allocs != mAllocBaseline[stage])
+        {
+            ASYNC_LOG_E("Alloc check: %llu allocations in %s between scan %d and %d", (unsigned long long)(counts.allocs - mAllocBaseline[stage]),
+                alloc::getStageName(stage), mAllocStartScan, scans);
+            failed = true;
+        }
+    }
+
+    if (!failed && scans < mAllocStartScan + ALLOC_CHECK_FRAMES) return;
+    if (!failed) ASYNC_LOG_I("Alloc check: no allocation in %d scans", scans - mAllocStartScan);
+    stopStages();
+    mFusion.stop();
+    asynclog::stop();
+    std::exit(failed ? 1 : 0);
+}
+#endif
+
+void MiniAreaScanApp::visualizeBlobs(const TrackedBlobTable &blobs)
 {
     static uint8_t sPalette[][3] =
     {
@@ -109,77 +186,99 @@ void MiniAreaScanApp::visualizeBlobs(const BlobTracker &blobTracker)
     }
 
     char idName[10];
-    for (const auto &blob : blobTracker.trackedBlobs)
+    for (size_t i = 0; i < blobs.size(); i++)
     {
-        int idx = blob.id % sPaletteCount;
+        int idx = blobs.id[i] % sPaletteCount;
         gl::color(Color8u(sPalette[idx][0], sPalette[idx][1], sPalette[idx][2]));
-        PolyLine2 line;
-        for (const auto &pt : blob.pts)
+        if (blobs.ptsCount[i] == 0)
+        {
+            // no polygon was requested from BlobFinder
+            const Rect &box = blobs.box[i];
+            gl::drawStrokedRect(Rectf(box.x, box.y, box.x + box.width, box.y + box.height));
+        }
+        else
         {
-            line.push_back(vec2(pt.x, pt.y));
+            PolyLine2 line;
+            for (uint32_t k = blobs.ptsFirst[i]; k < blobs.ptsFirst[i] + blobs.ptsCount[i]; k++)
+            {
+                line.push_back(vec2(blobs.pts[k].x, blobs.pts[k].y));
+            }
+            line.setClosed();
+            gl::drawSolid(line);
         }
-        line.setClosed();
-        gl::drawSolid(line);
-        sprintf(idName, "#%d", blob.id);
-        gl::drawStringCentered(idName, vec2(blob.center.x, blob.center.y));
+        sprintf(idName, "#%d", blobs.id[i]);
+        gl::drawStringCentered(idName, vec2(blobs.center[i].x, blobs.center[i].y));
     }
     gl::color(Color::white());
     gl::popModelMatrix();
 }
 
-void MiniAreaScanApp::sendTuioMessage(osc::SenderUdp &sender, const BlobTracker &blobTracker)
+void MiniAreaScanApp::sendTuioMessage(osc::SenderUdp &sender, const TrackedBlobTable &blobs, const OutputOption &option)
 {
-    osc::Bundle bundle;
-
-    osc::Message alive;
+    if (option.tuioDestinations != mTuioDestinations)
     {
-        alive.setAddress("/tuio/2Dcur");
-        alive.append("alive");
+        // remembered even when invalid, so that the error is only logged once
+        mTuioDestinations = option.tuioDestinations;
+        string error;
+        if (!mTuioFanout.setDestinations(mTuioDestinations, &error))
+        {
+            ASYNC_LOG_E("TUIO_DESTINATIONS: %s", error.c_str());
+        }
     }
 
-    osc::Message fseq;
+    // pixels to normalized input units, TuioFanout maps them to each destination's output
+    const float width = (float)option.frameWidth;
+    const float height = (float)option.frameHeight;
+    float scaleX = 1 / (option.inputX2 - option.inputX1) / width;
+    float scaleY = 1 / (option.inputY2 - option.inputY1) / height;
+
+    mTuioCursors.clear();
+    for (size_t i = 0; i < blobs.size(); i++)
     {
-        fseq.setAddress("/tuio/2Dcur");
-        fseq.append("fseq");
-        fseq.append((int32_t)getElapsedFrames());
+        vec2 center(blobs.center[i].x, blobs.center[i].y);
+
+        if (!option.inputRoi.contains(center)) continue;
+
+        TuioCursor cursor;
+        cursor.id = blobs.id[i];
+        cursor.x = lmap(center.x / width, option.inputX1, option.inputX2, 0.0f, 1.0f);
+        cursor.y = lmap(center.y / height, option.inputY1, option.inputY2, 0.0f, 1.0f);
+        cursor.vx = blobs.velocity[i].x * scaleX;
+        cursor.vy = blobs.velocity[i].y * scaleY;
+        cursor.accel = blobs.acceleration[i] * scaleX;
+        cursor.angle = blobs.angle[i];
+        cursor.width = blobs.rotBox[i].size.width * scaleX;
+        cursor.height = blobs.rotBox[i].size.height * scaleY;
+        cursor.area = blobs.area[i] * scaleX * scaleY;
+        cursor.rotationSpeed = blobs.angularVelocity[i];
+        cursor.rotationAccel = blobs.angularAcceleration[i];
+        mTuioCursors.push_back(cursor);
     }
 
-#if 0
-    SERVER_COUNT = math<int>::max(1, SERVER_COUNT);
-    SERVER_ID = math<int>::clamp(SERVER_ID, 0, SERVER_COUNT - 1);
-#else
-    int SERVER_COUNT = 1;
-    int SERVER_ID = 0;
-    float newRegion = 1 / (float)SERVER_COUNT;
-#endif
-    for (const auto &blob : blobTracker.trackedBlobs)
-    {
-        //Point2f center(blob.center.x + depthOrigin.x, blob.center.y + depthOrigin.y);
-        vec2 center(blob.center.x, blob.center.y);
-
-        if (!mInputRoi.contains(center)) continue;
-
-        osc::Message set;
-        set.setAddress("/tuio/2Dcur");
-        set.append("set");
-        set.append(blob.id);             // id
-        float mappedX = lmap(center.x / APP_WIDTH, INPUT_X1, INPUT_X2, OUTPUT_X1, OUTPUT_X2);
-        mappedX = (SERVER_ID + mappedX) * newRegion;
-        float mappedY = lmap(center.y / APP_HEIGHT, INPUT_Y1, INPUT_Y2, OUTPUT_Y1, OUTPUT_Y2);
-        set.append(mappedX);
-        set.append(mappedY);
-        set.append(blob.velocity.x / mOutputMap.getWidth());
-        set.append(blob.velocity.y / mOutputMap.getHeight());
-        set.append(0.0f);     // m
-        bundle.append(set);                         // add message to bundle
-
-        alive.append(blob.id);               // add blob to list of ALL active IDs
+    mTuioFanout.setDefaultMapping(option.mapping);
+    mTuioFanout.setMulticastTtl(option.multicastTtl);
+    mTuioFanout.setEncoderOptions(option.mtu, option.profiles, option.deltaMode, option.deltaThreshold, option.refreshFrames);
+    asio::error_code ec = mTuioFanout.send(*sender.getSocket(), mTuioCursors.data(), mTuioCursors.size(), PipelineStage::nowUs() / 1e6);
+    if (ec)
+    {
+        ASYNC_LOG_E("Failed to send TUIO: %s", ec.message().c_str());
     }
+}
 
-    bundle.append(alive);    //add message to bundle
-    bundle.append(fseq);     //add message to bundle
+void MiniAreaScanApp::publishShm(const TrackedBlobTable &blobs, const OutputOption &option)
+{
+    if (option.shmName != mShmName)
+    {
+        mShmName = option.shmName;
+        mShmPublisher.close();
+        if (!mShmName.empty() && !mShmPublisher.open(mShmName))
+        {
+            ASYNC_LOG_E("Failed to create shared memory %s", mShmName.c_str());
+        }
+    }
+    if (!mShmPublisher.isOpen()) return;
 
-    sender.send(bundle); //send bundle
+    mShmPublisher.publish(blobs, option.frameWidth, option.frameHeight, PipelineStage::nowUs());
 }
 
 void preSettings(App::Settings *settings)
@@ -9,8 +9,16 @@
 
 #include "cinder/osc/Osc.h"
 #include "CinderOpenCV.h"
-#include "BlobTracker.h"
-#include "../LidarDevice/LidarDevice.h"
+#include <mutex>
+#include <fstream>
+#include "ScanPipeline.h"
+#include "TuioFanout.h"
+#include "ShmPublisher.h"
+#include "LidarFusion.h"
+#include "ScanRegistration.h"
+#include "AllocCounter.h"
+#include "FrameQueue.h"
+#include "PipelineStage.h"
 
 using namespace std;
 using namespace ci;
@@ -29,13 +37,105 @@ public:
 
     void update() override;
 
+    void cleanup() override;
+
 private:
 
-    void updateDepthRelated();
+    void setupDevices();
+
+    // Background extrinsic registration, started with --register, the
+    // "Register lidars" button or every REGISTRATION_INTERVAL_S seconds
+    void requestRegistration();
+    void updateRegistration();
 
-    void visualizeBlobs(const BlobTracker &blobTracker);
+    // Builds the fusion AreaMask from the input ROI, AREA_INCLUDE,
+    // AREA_EXCLUDE and BLIND_SECTORS when one of them changed
+    void updateAreaMask();
+
+    void updateDepthRelated();
 
-    void sendTuioMessage(osc::SenderUdp &sender, const BlobTracker &blobTracker);
+    // Settings of the output stage, copied from the MiniConfig globals by update()
+    struct OutputOption
+    {
+        string tuioDestinations;
+        Rectf inputRoi;
+        float inputX1, inputY1, inputX2, inputY2;
+        TuioMapping mapping;
+        int multicastTtl;
+        size_t mtu;
+        int profiles;
+        bool deltaMode;
+        float deltaThreshold;
+        int refreshFrames;
+        string shmName;     // empty without SHM_ENABLED
+        int frameWidth, frameHeight;
+    };
+
+    // Settings of the detection stage, copied by update()
+    struct DetectionOption
+    {
+        LidarFusion::Option fusion;
+        ScanPipeline::Option pipeline;
+        int frameWidth = 0;
+        int frameHeight = 0;
+    };
+
+    // What the detection stage hands on, swapped through the queues
+    struct Frame
+    {
+        uint64_t captureUs = 0;
+        cv::Mat1b frontMat, diffMat;
+        TrackedBlobTable blobs;
+    };
+
+    // The acquisition threads of mFusion feed the detection stage (fusion,
+    // rasterization, blob finding and tracking), which feeds the output
+    // stage (TUIO and shared memory), which feeds update() and draw().
+    void startStages();
+    void stopStages();
+    void runDetection();
+    void runOutput();
+    void updateStages();
+
+    void visualizeBlobs(const TrackedBlobTable &blobs);
+
+    void sendTuioMessage(osc::SenderUdp &sender, const TrackedBlobTable &blobs, const OutputOption &option);
+
+    void publishShm(const TrackedBlobTable &blobs, const OutputOption &option);
+
+    // Compares TuioEncoder against the cinder::osc bundle path, run with --bench-tuio
+    void benchmarkTuio();
+
+    // Compares BitRaster dilate() and label() against cv::circle and
+    // cv::connectedComponentsWithStats on random rasters, run with --check-bit-raster
+    void checkBitRaster();
+
+#if defined(MINIAREASCAN_TRACE)
+    void setupTrace();
+    void updateTrace();
+    bool mTraceFlushRequested = false;
+#endif
+
+#if defined(MINIAREASCAN_ALLOC_COUNTER)
+    // Run with --alloc-check, built by the AllocCheck configuration: replays
+    // assets/alloc-check-scans.txt instead of LIDAR_DEVICES. Once
+    // ALLOC_CHECK_WARMUP scans went through the whole pipeline, any
+    // allocation in acquisition, detection, tracking or output exits with 1,
+    // ALLOC_CHECK_FRAMES clean scans after that exit with 0.
+    void updateAllocCheck();
+    bool mAllocCheck = false;
+    std::atomic<int> mAllocScans{ 0 };  // finished by the output stage
+    int mAllocStartScan = -1;
+    uint64_t mAllocBaseline[alloc::STAGE_COUNT] = {};
+#endif
+
+    // Run with --record-scans: appends every scan of device i to
+    // scans-<i>.txt next to the executable, for ReplayLidarDevice.
+    void recordScans();
+    bool mRecordScans = false;
+    vector<unique_ptr<std::ofstream>> mScanRecorders;
+    vector<uint64_t> mRecordedSequences;
+    vector<LidarScanPoint> mRecordedScan;
 
     float mFps = 0;
 
@@ -52,12 +152,19 @@ private:
     } mLayout;
 
     params::InterfaceGlRef mParams;
+    // outputs, owned by the output stage once it runs
     std::unique_ptr<osc::SenderUdp> mOscSender;
+    TuioFanout mTuioFanout;
+    string mTuioDestinations;
+    vector<TuioCursor> mTuioCursors;
+    ShmPublisher mShmPublisher;
+    string mShmName;
     float mMMtoPixel = -1;
     float mBaseAngle = -1;
 
-    // vision
-    BlobTracker mBlobTracker;
+    // vision, mPipeline and mFusionPoints belong to the detection stage
+    ScanPipeline mPipeline;
+    ScanPipeline::Option mPipelineOption;
 
     Rectf mInputRoi;
     Rectf mOutputMap;
@@ -66,9 +173,43 @@ private:
 
     gl::GlslProgRef	mShader;
 
-    unique_ptr<LidarDevice> mDevice;
+    LidarFusion mFusion;
+    LidarFusion::Option mFusionOption;
+    vector<cv::Point2f> mFusionPoints;
+    vector<string> mDeviceSpecs;    // "type:port" per fused device
+
+    // declared after mFusion so that its thread stops first
+    ScanRegistration mRegistration;
+    double mLastRegistrationTime = 0;
+    AreaMask mAreaMask;
+    string mAreaSpec;
 
-    cv::Mat1b mFrontMat, mDiffMat;
     Channel mFrontSurface, mDiffSurface;
     gl::TextureRef mFrontTexture, mDiffTexture;
+
+    // declared last so that the stages stop before what they use
+    std::mutex mStageOptionMutex;
+    DetectionOption mPendingDetectionOption;
+    OutputOption mPendingOutputOption;
+    OutputOption mOutputOption;     // output stage only
+    string mCpuSpec;
+    string mLidarThreadSpec;
+    FrameQueue<Frame> mOutputQueue{ 2 };
+    FrameQueue<Frame> mDisplayQueue{ 2 };
+    Frame mDetectionFrame;      // detection stage only
+    Frame mOutputFrame;         // output stage only
+    Frame mDisplayFrame;        // main thread only
+    PipelineStage mDetectionStage, mOutputStage;
+    double mLastStageStatsTime = 0;
+
+    // stage statistics shown in the params UI
+    float mDetectionLatencyMs = 0;  // from the newest scan to the end of detection
+    float mOutputLatencyMs = 0;     // from the newest scan to the end of output
+    float mOutputMaxLatencyMs = 0;
+    float mDetectionBusyMs = 0;
+    int mDroppedFrames = 0;
+    float mPacketJitterUs = 0;      // worst device, standard deviation of the packet interval
+    float mPacketMaxUs = 0;
+    int mLogSuppressed = 0;
+    int mLogDropped = 0;
 };
@@ -0,0 +1,209 @@
+#include "MiniAreaScan.h"
+#include "ScanPipeline.h"
+#include "ShmPublisher.h"
+#include "AllocCounter.h"
+#include "FrameQueue.h"
+#include "PipelineStage.h"
+#include "../LidarDevice/RpLidarDevice.h"
+#include "../LidarDevice/YdLidarDevice.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+struct mas_scan
+{
+    uint64_t captureUs = 0;
+    std::vector<LidarScanPoint> points;
+};
+
+struct mas_tracker
+{
+    std::unique_ptr<LidarDevice> device;
+    ScanPipeline pipeline;
+    ScanPipeline::Option option;
+
+    mas_frame_callback callback = nullptr;
+    void *userData = nullptr;
+
+    // the acquisition stage reads the device and hands its scans to the
+    // processing stage, which drops the oldest scan when it falls behind
+    PipelineStage acquisition, processing;
+    FrameQueue<mas_scan> scans{ 2 };
+    mas_scan acquiredScan;      // acquisition stage only
+    mas_scan processedScan;     // processing stage only
+    std::atomic<bool> running{ false };
+    uint32_t frame = 0;
+
+    std::mutex statusMutex;
+    std::string status;
+
+    // frame views, reused across frames
+    std::vector<mas_scan_point> points;
+    std::vector<mas_blob> blobs;
+};
+
+namespace
+{
+    void runAcquisition(mas_tracker *tracker)
+    {
+        bool updated;
+        {
+            ALLOC_STAGE(STAGE_ACQUISITION);
+            updated = tracker->device->update();
+            std::lock_guard<std::mutex> lock(tracker->statusMutex);
+            tracker->status = tracker->device->status;
+        }
+        if (!updated)
+        {
+            // not connected or no scan yet, don't spin
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            return;
+        }
+
+        {
+            ALLOC_STAGE(STAGE_ACQUISITION);
+            const auto &scanData = tracker->device->scanData;
+            tracker->acquiredScan.captureUs = PipelineStage::nowUs();
+            tracker->acquiredScan.points.assign(scanData.begin(), scanData.end());
+        }
+        tracker->scans.push(tracker->acquiredScan);
+    }
+
+    void runProcessing(mas_tracker *tracker)
+    {
+        mas_scan &scan = tracker->processedScan;
+        if (!tracker->scans.pop(scan)) return;
+
+        uint64_t startUs = PipelineStage::nowUs();
+        tracker->pipeline.process(scan.points, tracker->option);
+        if (tracker->callback)
+        {
+            ALLOC_STAGE(STAGE_OUTPUT);
+            const auto &scanData = scan.points;
+            tracker->points.resize(scanData.size());
+            for (size_t i = 0; i < scanData.size(); i++)
+            {
+                tracker->points[i].dist = scanData[i].dist;
+                tracker->points[i].angle = scanData[i].angle;
+                tracker->points[i].valid = scanData[i].valid;
+            }
+            const auto &trackedBlobs = tracker->pipeline.tracker.trackedBlobs;
+            tracker->blobs.resize(trackedBlobs.size());
+            for (size_t i = 0; i < trackedBlobs.size(); i++)
+            {
+                fillMasBlob(tracker->blobs[i], trackedBlobs, i);
+            }
+
+            mas_frame frame;
+            frame.frame = ++tracker->frame;
+            frame.timestamp_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+            frame.frame_width = tracker->pipeline.getWidth();
+            frame.frame_height = tracker->pipeline.getHeight();
+            frame.points = tracker->points.data();
+            frame.point_count = (uint32_t)tracker->points.size();
+            frame.blobs = tracker->blobs.data();
+            frame.blob_count = (uint32_t)tracker->blobs.size();
+            tracker->callback(&frame, tracker->userData);
+        }
+        tracker->processing.addFrame(scan.captureUs, startUs);
+    }
+}
+
+uint32_t mas_api_version(void)
+{
+    return MAS_API_VERSION;
+}
+
+void mas_default_options(mas_options *options)
+{
+    ScanPipeline::Option option;
+    options->frame_width = 1024;
+    options->frame_height = 768;
+    options->mm_to_pixel = option.mmToPixel;
+    options->base_angle = option.baseAngle;
+    options->dot_radius = option.dotRadius;
+    options->min_area = 100;
+}
+
+mas_tracker *mas_open(int32_t device_type, const char *serial_port, const mas_options *options)
+{
+    mas_options defaults;
+    if (!options)
+    {
+        mas_default_options(&defaults);
+        options = &defaults;
+    }
+    if (options->frame_width <= 0 || options->frame_height <= 0 || !serial_port) return nullptr;
+
+    std::unique_ptr<mas_tracker> tracker(new mas_tracker());
+    if (device_type == MAS_DEVICE_YDLIDAR)
+    {
+        tracker->device.reset(new YdLidarDevice());
+    }
+    else
+    {
+        tracker->device.reset(new RpLidarDevice());
+    }
+    if (!tracker->device->setup(serial_port)) return nullptr;
+
+    tracker->pipeline.setup(options->frame_width, options->frame_height);
+    tracker->option.mmToPixel = options->mm_to_pixel;
+    tracker->option.baseAngle = options->base_angle;
+    tracker->option.dotRadius = options->dot_radius;
+    tracker->option.frontRadius = 0;
+    tracker->option.diffImage = false;
+    tracker->option.finder.minArea = options->min_area;
+    // mas_blob carries the rotated box but no polygon
+    tracker->option.finder.outputs = BlobFinder::OUTPUT_SHAPE;
+    tracker->status = tracker->device->status;
+    return tracker.release();
+}
+
+void mas_close(mas_tracker *tracker)
+{
+    if (!tracker) return;
+    mas_stop(tracker);
+    delete tracker;
+}
+
+void mas_set_frame_callback(mas_tracker *tracker, mas_frame_callback callback, void *user_data)
+{
+    if (!tracker || tracker->running) return;
+    tracker->callback = callback;
+    tracker->userData = user_data;
+}
+
+int32_t mas_start(mas_tracker *tracker)
+{
+    if (!tracker) return -1;
+    if (tracker->running) return 0;
+    tracker->running = true;
+    tracker->scans.open();
+    tracker->processing.start("mas processing", [tracker] { runProcessing(tracker); });
+    tracker->acquisition.start("mas acquisition", [tracker] { runAcquisition(tracker); });
+    return 0;
+}
+
+void mas_stop(mas_tracker *tracker)
+{
+    if (!tracker || !tracker->running) return;
+    tracker->running = false;
+    // the processing stage only leaves a waiting pop once the queue is closed
+    tracker->scans.close();
+    tracker->acquisition.stop();
+    tracker->processing.stop();
+}
+
+const char *mas_status(mas_tracker *tracker)
+{
+    if (!tracker) return "";
+    // copy out under the lock, the acquisition thread keeps updating status
+    static thread_local std::string status;
+    std::lock_guard<std::mutex> lock(tracker->statusMutex);
+    status = tracker->status;
+    return status.c_str();
+}
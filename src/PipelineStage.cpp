@@ -0,0 +1,100 @@
+#include "PipelineStage.h"
+#include "Trace.h"
+
+#include <chrono>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+bool setThreadAffinity(std::thread &thread, uint64_t cpuMask)
+{
+#if defined(_WIN32)
+    DWORD_PTR mask = (DWORD_PTR)cpuMask;
+    if (mask == 0)
+    {
+        DWORD_PTR systemMask;
+        if (!GetProcessAffinityMask(GetCurrentProcess(), &mask, &systemMask)) return false;
+    }
+    return SetThreadAffinityMask(thread.native_handle(), mask) != 0;
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+    {
+        if (cpuMask == 0 || (cpu < 64 && (cpuMask >> cpu) & 1)) CPU_SET(cpu, &set);
+    }
+    return pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
+
+PipelineStage::~PipelineStage()
+{
+    stop();
+}
+
+void PipelineStage::start(const char *name, std::function<void()> step)
+{
+    if (mRunning) return;
+    mRunning = true;
+    mThread = std::thread(&PipelineStage::run, this, name, std::move(step));
+    if (mAffinity != 0) setThreadAffinity(mThread, mAffinity);
+}
+
+void PipelineStage::stop()
+{
+    if (!mRunning) return;
+    mRunning = false;
+    if (mThread.joinable()) mThread.join();
+}
+
+void PipelineStage::setAffinity(uint64_t cpuMask)
+{
+    if (mAffinity.exchange(cpuMask) == cpuMask) return;
+    if (mThread.joinable()) setThreadAffinity(mThread, cpuMask);
+}
+
+void PipelineStage::run(const char *name, std::function<void()> step)
+{
+    (void)name;     // unused without MINIAREASCAN_TRACE
+    TRACE_THREAD_NAME(name);
+    while (mRunning)
+    {
+        step();
+    }
+}
+
+void PipelineStage::addFrame(uint64_t captureUs, uint64_t startUs)
+{
+    uint64_t endUs = nowUs();
+    uint64_t latencyUs = endUs - captureUs;
+    mFrames.fetch_add(1, std::memory_order_relaxed);
+    mBusyUs.fetch_add(endUs - startUs, std::memory_order_relaxed);
+    mLatencyUs.fetch_add(latencyUs, std::memory_order_relaxed);
+    uint64_t maxUs = mMaxLatencyUs.load(std::memory_order_relaxed);
+    while (latencyUs > maxUs && !mMaxLatencyUs.compare_exchange_weak(maxUs, latencyUs, std::memory_order_relaxed))
+    {
+    }
+}
+
+PipelineStage::Stats PipelineStage::takeStats()
+{
+    Stats stats;
+    stats.frames = mFrames.exchange(0);
+    float frames = stats.frames > 0 ? (float)stats.frames : 1;
+    stats.busyUs = mBusyUs.exchange(0) / frames;
+    stats.latencyUs = mLatencyUs.exchange(0) / frames;
+    stats.maxLatencyUs = (float)mMaxLatencyUs.exchange(0);
+    return stats;
+}
+
+uint64_t PipelineStage::nowUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
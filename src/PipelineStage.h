@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <stdint.h>
+#include <thread>
+
+// One worker thread of a staged pipeline, see FrameQueue.h for the queues
+// between the stages.
+//
+// The thread calls step() until stop(). step() usually pops a frame from its
+// input queue, works on it and pushes it on, and reports each finished frame
+// with addFrame() for the latency statistics. A step() blocked on a queue
+// only returns once the queue is closed, so close the queues of a stage
+// before stopping it.
+class PipelineStage
+{
+public:
+    struct Stats
+    {
+        uint64_t frames;
+        float busyUs;           // average time per frame spent in step()
+        float latencyUs;        // average time from capture to the end of this stage
+        float maxLatencyUs;
+    };
+
+    ~PipelineStage();
+
+    // name must be a string literal, it names the thread in the trace.
+    void start(const char *name, std::function<void()> step);
+    void stop();
+    bool isRunning() const { return mRunning; }
+
+    // Bit i allows cpu i, 0 allows all of them. Safe to call while running.
+    void setAffinity(uint64_t cpuMask);
+
+    // startUs is when step() took the frame, captureUs when its scan was
+    // taken, both from nowUs().
+    void addFrame(uint64_t captureUs, uint64_t startUs);
+
+    // Statistics of the frames since the previous call.
+    Stats takeStats();
+
+    static uint64_t nowUs();
+
+private:
+    void run(const char *name, std::function<void()> step);
+
+    std::thread mThread;
+    std::atomic<bool> mRunning{ false };
+    std::atomic<uint64_t> mAffinity{ 0 };
+
+    std::atomic<uint64_t> mFrames{ 0 };
+    std::atomic<uint64_t> mBusyUs{ 0 };
+    std::atomic<uint64_t> mLatencyUs{ 0 };
+    std::atomic<uint64_t> mMaxLatencyUs{ 0 };
+};
+
+// Bit i allows cpu i, 0 allows all of them. Returns false where thread
+// affinity is not supported.
+bool setThreadAffinity(std::thread &thread, uint64_t cpuMask);
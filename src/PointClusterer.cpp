@@ -0,0 +1,168 @@
+#include "PointClusterer.h"
+
+#include <math.h>
+#include <algorithm>
+
+namespace
+{
+    inline int64_t cellKey(int64_t cx, int64_t cy)
+    {
+        return (cx << 32) ^ (cy & 0xffffffff);
+    }
+}
+
+uint32_t PointClusterer::find(uint32_t i)
+{
+    // path halving
+    while (mParent[i] != i)
+    {
+        mParent[i] = mParent[mParent[i]];
+        i = mParent[i];
+    }
+    return i;
+}
+
+void PointClusterer::unite(uint32_t a, uint32_t b)
+{
+    a = find(a);
+    b = find(b);
+    if (a == b) return;
+    if (mRank[a] < mRank[b]) std::swap(a, b);
+    mParent[b] = a;
+    if (mRank[a] == mRank[b]) mRank[a]++;
+}
+
+size_t PointClusterer::findCell(int64_t cell, size_t &last) const
+{
+    // mCellStarts indexes mCellPoints, so search the cells by their first entry
+    auto it = std::lower_bound(mCellStarts.begin(), mCellStarts.end() - 1, cell,
+        [this](size_t start, int64_t key) { return mCellPoints[start].cell < key; });
+    if (it == mCellStarts.end() - 1 || mCellPoints[*it].cell != cell) return SIZE_MAX;
+    last = *(it + 1);
+    return *it;
+}
+
+void PointClusterer::uniteCells(size_t first, size_t last, size_t otherFirst, size_t otherLast, float distanceSq)
+{
+    for (size_t i = first; i < last; i++)
+    {
+        uint32_t a = mCellPoints[i].index;
+        for (size_t j = otherFirst == first ? i + 1 : otherFirst; j < otherLast; j++)
+        {
+            uint32_t b = mCellPoints[j].index;
+            float dx = mX[a] - mX[b];
+            float dy = mY[a] - mY[b];
+            if (dx * dx + dy * dy < distanceSq && find(a) != find(b)) unite(a, b);
+        }
+    }
+}
+
+size_t PointClusterer::run(float distance, uint32_t minPoints)
+{
+    const uint32_t count = (uint32_t)mX.size();
+    mClusters.clear();
+    mIndices.clear();
+    if (count == 0 || distance <= 0) return 0;
+
+    const float invCell = 1 / distance;
+    const float distanceSq = distance * distance;
+
+    mCellPoints.resize(count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        mCellPoints[i] = { cellKey((int64_t)floorf(mX[i] * invCell), (int64_t)floorf(mY[i] * invCell)), i };
+    }
+    std::sort(mCellPoints.begin(), mCellPoints.end(),
+        [](const CellPoint &a, const CellPoint &b) { return a.cell < b.cell; });
+
+    mCellStarts.clear();
+    for (size_t i = 0; i < count; i++)
+    {
+        if (i == 0 || mCellPoints[i].cell != mCellPoints[i - 1].cell) mCellStarts.push_back(i);
+    }
+    mCellStarts.push_back(count);
+
+    mParent.resize(count);
+    mRank.assign(count, 0);
+    for (uint32_t i = 0; i < count; i++) mParent[i] = i;
+
+    // every pair of neighbouring cells is visited once: the cell itself plus
+    // the 4 neighbours after it in (y, x) order
+    const int kNeighbours[4][2] = { { 1, 0 }, { -1, 1 }, { 0, 1 }, { 1, 1 } };
+    for (size_t c = 0; c + 1 < mCellStarts.size(); c++)
+    {
+        size_t first = mCellStarts[c];
+        size_t last = mCellStarts[c + 1];
+        uniteCells(first, last, first, last, distanceSq);
+
+        uint32_t sample = mCellPoints[first].index;
+        int64_t cx = (int64_t)floorf(mX[sample] * invCell);
+        int64_t cy = (int64_t)floorf(mY[sample] * invCell);
+        for (const auto &n : kNeighbours)
+        {
+            size_t otherLast;
+            size_t otherFirst = findCell(cellKey(cx + n[0], cy + n[1]), otherLast);
+            if (otherFirst != SIZE_MAX) uniteCells(first, last, otherFirst, otherLast, distanceSq);
+        }
+    }
+
+    // counting sort of the points by root, roots numbered in order of appearance
+    mClusterOf.assign(count, UINT32_MAX);
+    std::vector<uint32_t> &rootCluster = mRank;   // rank is not needed any more
+    std::fill(rootCluster.begin(), rootCluster.end(), UINT32_MAX);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint32_t root = find(i);
+        if (rootCluster[root] == UINT32_MAX)
+        {
+            rootCluster[root] = (uint32_t)mClusters.size();
+            mClusters.push_back({ mX[i], mY[i], mX[i], mY[i], 0, 0, 0, 0, 0 });
+        }
+        mClusterOf[i] = rootCluster[root];
+        mClusters[mClusterOf[i]].count++;
+    }
+    uint32_t offset = 0;
+    for (auto &cluster : mClusters)
+    {
+        cluster.first = offset;
+        offset += cluster.count;
+        cluster.count = 0;
+    }
+    mIndices.resize(count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        Cluster &cluster = mClusters[mClusterOf[i]];
+        mIndices[cluster.first + cluster.count++] = i;
+    }
+
+    // bounds, centroid and orientation from the second order moments
+    size_t kept = 0;
+    for (auto &cluster : mClusters)
+    {
+        if (cluster.count < minPoints) continue;
+        float sx = 0, sy = 0, sxx = 0, syy = 0, sxy = 0;
+        for (uint32_t k = cluster.first; k < cluster.first + cluster.count; k++)
+        {
+            float x = mX[mIndices[k]], y = mY[mIndices[k]];
+            cluster.minX = std::min(cluster.minX, x);
+            cluster.maxX = std::max(cluster.maxX, x);
+            cluster.minY = std::min(cluster.minY, y);
+            cluster.maxY = std::max(cluster.maxY, y);
+            sx += x;
+            sy += y;
+            sxx += x * x;
+            syy += y * y;
+            sxy += x * y;
+        }
+        float n = (float)cluster.count;
+        cluster.centerX = sx / n;
+        cluster.centerY = sy / n;
+        float mu20 = sxx / n - cluster.centerX * cluster.centerX;
+        float mu02 = syy / n - cluster.centerY * cluster.centerY;
+        float mu11 = sxy / n - cluster.centerX * cluster.centerY;
+        cluster.angle = 0.5f * atan2f(2 * mu11, mu20 - mu02);
+        mClusters[kept++] = cluster;
+    }
+    mClusters.resize(kept);
+    return kept;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+// Euclidean clustering of unordered 2d points: two points closer than the
+// distance end up in the same cluster, transitively (single linkage).
+//
+// Points are bucketed in a uniform grid with the distance as cell size, so
+// only the 3x3 neighbourhood of a point is tested, and clusters are built
+// with union-find. It does not rely on scan order, so it also works on
+// clouds merged from several lidars. All buffers are kept between calls.
+class PointClusterer
+{
+public:
+    struct Cluster
+    {
+        float minX, minY, maxX, maxY;
+        float centerX, centerY;
+        float angle;        // radians, principal axis of the points
+        uint32_t first;     // into getIndices()
+        uint32_t count;
+    };
+
+    // P is any type with x and y members (cv::Point, cv::Point2f, ...).
+    template <typename P>
+    size_t execute(const P *points, size_t count, float distance, uint32_t minPoints = 1)
+    {
+        mX.resize(count);
+        mY.resize(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            mX[i] = (float)points[i].x;
+            mY[i] = (float)points[i].y;
+        }
+        return run(distance, minPoints);
+    }
+
+    const std::vector<Cluster> &getClusters() const { return mClusters; }
+
+    // Point indices grouped by cluster, see Cluster::first and count.
+    const std::vector<uint32_t> &getIndices() const { return mIndices; }
+
+private:
+    struct CellPoint
+    {
+        int64_t cell;
+        uint32_t index;
+    };
+
+    size_t run(float distance, uint32_t minPoints);
+    uint32_t find(uint32_t i);
+    void unite(uint32_t a, uint32_t b);
+    void uniteCells(size_t first, size_t last, size_t otherFirst, size_t otherLast, float distanceSq);
+    size_t findCell(int64_t cell, size_t &last) const;
+
+    std::vector<float> mX, mY;
+    std::vector<CellPoint> mCellPoints;     // sorted by cell
+    std::vector<size_t> mCellStarts;        // first entry of every distinct cell, plus the end
+    std::vector<uint32_t> mParent;
+    std::vector<uint32_t> mRank;
+    std::vector<uint32_t> mClusterOf;
+    std::vector<Cluster> mClusters;
+    std::vector<uint32_t> mIndices;
+};
@@ -0,0 +1,298 @@
+#include "PolarMask.h"
+#include "LidarFusion.h"
+
+#include <math.h>
+#include <float.h>
+#include <stdint.h>
+#include <algorithm>
+
+namespace
+{
+    const float kEpsilon = 1e-4f;
+    const float kBinEpsilon = 1e-3f;    // fraction of a bin
+
+    struct Edge
+    {
+        cv::Point2f a, b;
+    };
+
+    struct Crossing
+    {
+        float t0, t1;   // distance along the first and the last ray of the bin
+        size_t edge;
+    };
+
+    bool polygonContains(const std::vector<cv::Point2f> &poly, const cv::Point2f &pt)
+    {
+        bool inside = false;
+        for (size_t i = 0, j = poly.size() - 1; i < poly.size(); j = i++)
+        {
+            const cv::Point2f &a = poly[i], &b = poly[j];
+            if ((a.y > pt.y) != (b.y > pt.y) && pt.x < (b.x - a.x) * (pt.y - a.y) / (b.y - a.y) + a.x)
+            {
+                inside = !inside;
+            }
+        }
+        return inside;
+    }
+
+    inline float cross(const cv::Point2f &a, const cv::Point2f &b)
+    {
+        return a.x * b.y - a.y * b.x;
+    }
+
+    // distance along the ray where it crosses the edge
+    bool rayCrossing(const Edge &edge, const cv::Point2f &origin, const cv::Point2f &dir, float &t)
+    {
+        cv::Point2f e(edge.b.x - edge.a.x, edge.b.y - edge.a.y);
+        float denom = cross(dir, e);
+        if (fabsf(denom) < 1e-9f) return false;
+        cv::Point2f w(edge.a.x - origin.x, edge.a.y - origin.y);
+        t = cross(w, e) / denom;
+        float u = cross(w, dir) / denom;
+        return t > 0 && u >= 0 && u <= 1;
+    }
+
+    bool edgesIntersect(const Edge &p, const Edge &q, cv::Point2f &pt)
+    {
+        cv::Point2f r(p.b.x - p.a.x, p.b.y - p.a.y), s(q.b.x - q.a.x, q.b.y - q.a.y);
+        float denom = cross(r, s);
+        if (fabsf(denom) < 1e-9f) return false;
+        cv::Point2f w(q.a.x - p.a.x, q.a.y - p.a.y);
+        float t = cross(w, s) / denom;
+        float u = cross(w, r) / denom;
+        if (t < 0 || t > 1 || u < 0 || u > 1) return false;
+        pt = cv::Point2f(p.a.x + r.x * t, p.a.y + r.y * t);
+        return true;
+    }
+
+    inline float wrapDegree(float angle)
+    {
+        angle = fmodf(angle, 360.0f);
+        return angle < 0 ? angle + 360 : angle;
+    }
+
+    // device angle in degree of a vector from the device
+    inline float deviceAngle(const cv::Point2f &v, float poseAngle)
+    {
+        return wrapDegree(atan2f(v.x, v.y) * 180 / (float)CV_PI + poseAngle);
+    }
+
+    // Closest distance to the origin of the part of an edge between the two
+    // rays of a bin. Along the edge it is convex, so it lies on one of the
+    // rays (endMin) unless the foot of the perpendicular lies in between.
+    float closestDistance(const Edge &edge, const cv::Point2f &origin, float angle0, float angle1, float poseAngle, float endMin)
+    {
+        cv::Point2f e(edge.b.x - edge.a.x, edge.b.y - edge.a.y);
+        cv::Point2f w(edge.a.x - origin.x, edge.a.y - origin.y);
+        float k = -(w.x * e.x + w.y * e.y) / (e.x * e.x + e.y * e.y);
+        cv::Point2f foot(w.x + e.x * k, w.y + e.y * k);
+        float footAngle = deviceAngle(foot, poseAngle);
+        if (footAngle < angle0 || footAngle > angle1) return endMin;
+        return std::min(endMin, sqrtf(foot.x * foot.x + foot.y * foot.y));
+    }
+}
+
+bool AreaMask::contains(const cv::Point2f &pt) const
+{
+    if (roi.size() >= 3 && !polygonContains(roi, pt)) return false;
+    if (!include.empty())
+    {
+        bool inside = false;
+        for (const auto &poly : include)
+        {
+            if (poly.size() >= 3 && polygonContains(poly, pt))
+            {
+                inside = true;
+                break;
+            }
+        }
+        if (!inside) return false;
+    }
+    for (const auto &poly : exclude)
+    {
+        if (poly.size() >= 3 && polygonContains(poly, pt)) return false;
+    }
+    return true;
+}
+
+bool PolarMask::inSector(float angle) const
+{
+    angle = wrapDegree(angle);
+    for (const auto &sector : mArea.sectors)
+    {
+        float from = wrapDegree(sector.x), to = wrapDegree(sector.y);
+        bool inside = from <= to ? (angle >= from && angle <= to) : (angle >= from || angle <= to);
+        if (inside) return true;
+    }
+    return false;
+}
+
+void PolarMask::compile(const AreaMask &area, const LidarPose &pose)
+{
+    mArea = area;
+    mX = pose.x;
+    mY = pose.y;
+    mAngle = pose.angle;
+    mEmpty = area.empty();
+    if (mEmpty) return;
+
+    std::vector<Edge> edges;
+    auto addEdges = [&](const std::vector<cv::Point2f> &poly) {
+        if (poly.size() < 3) return;
+        for (size_t i = 0, j = poly.size() - 1; i < poly.size(); j = i++) edges.push_back({ poly[j], poly[i] });
+    };
+    addEdges(area.roi);
+    for (const auto &poly : area.include) addEdges(poly);
+    for (const auto &poly : area.exclude) addEdges(poly);
+
+    // bins in which the outline changes: vertices and edge intersections
+    const cv::Point2f origin(mX, mY);
+    std::vector<uint8_t> split(BIN_COUNT, 0);
+    auto splitAt = [&](const cv::Point2f &pt) {
+        cv::Point2f v(pt.x - origin.x, pt.y - origin.y);
+        if (v.x * v.x + v.y * v.y < kEpsilon)
+        {
+            split.assign(BIN_COUNT, 1);
+            return;
+        }
+        float bin = deviceAngle(v, mAngle) * BINS_PER_DEGREE;
+        int index = (int)bin;
+        split[index % BIN_COUNT] = 1;
+        if (bin - index < kBinEpsilon) split[(index + BIN_COUNT - 1) % BIN_COUNT] = 1;
+        if (bin - index > 1 - kBinEpsilon) split[(index + 1) % BIN_COUNT] = 1;
+    };
+    for (size_t i = 0; i < edges.size(); i++)
+    {
+        splitAt(edges[i].a);
+        for (size_t j = i + 1; j < edges.size(); j++)
+        {
+            cv::Point2f pt;
+            if (edgesIntersect(edges[i], edges[j], pt)) splitAt(pt);
+        }
+    }
+
+    // sector parts within [angle0, angle1]: 0 none, 1 some, 2 all of it
+    std::vector<cv::Point2f> covered;
+    auto sectorCoverage = [&](float angle0, float angle1) {
+        covered.clear();
+        for (const auto &sector : area.sectors)
+        {
+            float from = wrapDegree(sector.x), to = wrapDegree(sector.y);
+            cv::Point2f parts[2] = { { from, to }, { 0, to } };
+            int count = 1;
+            if (from > to)
+            {
+                parts[0].y = 360;
+                count = 2;
+            }
+            for (int i = 0; i < count; i++)
+            {
+                float a = std::max(parts[i].x, angle0), b = std::min(parts[i].y, angle1);
+                if (a <= b) covered.push_back({ a, b });
+            }
+        }
+        if (covered.empty()) return 0;
+        std::sort(covered.begin(), covered.end(),
+            [](const cv::Point2f &a, const cv::Point2f &b) { return a.x < b.x; });
+        float reached = angle0;
+        for (const auto &c : covered)
+        {
+            if (c.x > reached) return 1;
+            reached = std::max(reached, c.y);
+        }
+        return reached >= angle1 ? 2 : 1;
+    };
+
+    std::vector<Crossing> crossings;
+    mBins.resize(BIN_COUNT);
+    for (int bin = 0; bin < BIN_COUNT; bin++)
+    {
+        Bin &b = mBins[bin];
+        b.minDist = FLT_MAX;
+        b.maxDist = -1;
+        b.innerMin = FLT_MAX;
+        b.innerMax = -1;
+
+        float angle0 = (float)bin / BINS_PER_DEGREE, angle1 = (float)(bin + 1) / BINS_PER_DEGREE;
+        int coverage = sectorCoverage(angle0, angle1);
+        if (coverage == 2) continue;
+        if (split[bin] || coverage > 0)
+        {
+            b.minDist = 0;
+            b.maxDist = FLT_MAX;
+            continue;
+        }
+
+        // Without vertices and intersections in the bin, every edge that enters
+        // it crosses both of its rays, and the edges keep their order.
+        float rad0 = (angle0 - mAngle) * (float)CV_PI / 180, rad1 = (angle1 - mAngle) * (float)CV_PI / 180;
+        cv::Point2f dir0(sinf(rad0), cosf(rad0)), dir1(sinf(rad1), cosf(rad1));
+        crossings.clear();
+        for (size_t e = 0; e < edges.size(); e++)
+        {
+            float t0, t1;
+            if (rayCrossing(edges[e], origin, dir0, t0) && rayCrossing(edges[e], origin, dir1, t1))
+            {
+                crossings.push_back({ t0, t1, e });
+            }
+        }
+        std::sort(crossings.begin(), crossings.end(),
+            [](const Crossing &a, const Crossing &b) { return a.t0 < b.t0; });
+
+        // intervals between consecutive crossings, from the device to infinity
+        int intervals = 0;
+        bool previousActive = false;
+        float innerMin = 0, innerMax = 0;
+        for (size_t i = 0; i <= crossings.size(); i++)
+        {
+            float t0 = i > 0 ? crossings[i - 1].t0 : 0;
+            float mid = i < crossings.size() ? (t0 + crossings[i].t0) / 2 : t0 + 1000;
+            if (!area.contains(cv::Point2f(origin.x + dir0.x * mid, origin.y + dir0.y * mid)))
+            {
+                previousActive = false;
+                continue;
+            }
+
+            float nearMin = 0, nearMax = 0, farMin = FLT_MAX, farMax = FLT_MAX;
+            if (i > 0)
+            {
+                const Crossing &c = crossings[i - 1];
+                nearMin = closestDistance(edges[c.edge], origin, angle0, angle1, mAngle, std::min(c.t0, c.t1));
+                nearMax = std::max(c.t0, c.t1);
+            }
+            if (i < crossings.size())
+            {
+                const Crossing &c = crossings[i];
+                farMin = closestDistance(edges[c.edge], origin, angle0, angle1, mAngle, std::min(c.t0, c.t1));
+                farMax = std::max(c.t0, c.t1);
+            }
+            b.minDist = std::min(b.minDist, nearMin);
+            b.maxDist = std::max(b.maxDist, farMax);
+            if (!previousActive)
+            {
+                intervals++;
+                innerMin = nearMax;
+            }
+            innerMax = farMin;
+            previousActive = true;
+        }
+        if (b.maxDist < 0) continue;
+
+        // float rounding must neither reject an active point nor accept an inactive one
+        b.minDist *= 1 - kEpsilon;
+        if (b.maxDist < FLT_MAX) b.maxDist *= 1 + kEpsilon;
+        if (intervals == 1)
+        {
+            b.innerMin = innerMin * (1 + kEpsilon);
+            b.innerMax = innerMax < FLT_MAX ? innerMax * (1 - kEpsilon) : FLT_MAX;
+        }
+    }
+}
+
+bool PolarMask::acceptsSlow(float angle, float dist) const
+{
+    if (inSector(angle)) return false;
+    float rad = (angle - mAngle) * (float)CV_PI / 180;
+    return mArea.contains(cv::Point2f(mX + sinf(rad) * dist, mY + cosf(rad) * dist));
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <math.h>
+#include <vector>
+
+#include "opencv2/core/core.hpp"
+
+struct LidarPose;
+
+// Active tracking area in world millimeter. A point is active when it is
+// inside roi (if any), inside one of the include polygons (if any), outside
+// every exclude polygon and not in a blind sector of its device.
+struct AreaMask
+{
+    std::vector<cv::Point2f> roi;
+    std::vector<std::vector<cv::Point2f>> include;
+    std::vector<std::vector<cv::Point2f>> exclude;
+    std::vector<cv::Point2f> sectors;   // device angle ranges in degree, x = from, y = to
+
+    bool empty() const { return roi.empty() && include.empty() && exclude.empty() && sectors.empty(); }
+    bool contains(const cv::Point2f &pt) const;
+
+    bool operator==(const AreaMask &other) const
+    {
+        return roi == other.roi && include == other.include && exclude == other.exclude && sectors == other.sectors;
+    }
+    bool operator!=(const AreaMask &other) const { return !(*this == other); }
+};
+
+// AreaMask compiled for one device pose into a per angle bin range table,
+// so that most points are accepted or rejected in polar coordinates with
+// one lookup, before any projection. Points outside [minDist, maxDist] are
+// rejected and points inside [innerMin, innerMax] are accepted; both ranges
+// are exact over the whole bin, taken from the polygon edges that cross it.
+// Everything in between, and every point of a bin that holds a polygon
+// vertex, an edge intersection or the edge of a blind sector, falls back to
+// the polygon tests.
+class PolarMask
+{
+public:
+    enum
+    {
+        BINS_PER_DEGREE = 10,
+        BIN_COUNT = 360 * BINS_PER_DEGREE,
+    };
+
+    void compile(const AreaMask &area, const LidarPose &pose);
+
+    bool isEmpty() const { return mEmpty; }
+
+    // angle in degree and dist in millimeter, as in LidarScanPoint
+    bool accepts(float angle, float dist) const
+    {
+        if (mEmpty) return true;
+        angle -= floorf(angle / 360) * 360;
+        int bin = (int)(angle * BINS_PER_DEGREE);
+        if (bin >= BIN_COUNT) bin -= BIN_COUNT;
+        const Bin &b = mBins[bin];
+        if (dist < b.minDist || dist > b.maxDist) return false;
+        if (dist >= b.innerMin && dist <= b.innerMax) return true;
+        return acceptsSlow(angle, dist);
+    }
+
+private:
+    struct Bin
+    {
+        float minDist, maxDist;     // outside is rejected
+        float innerMin, innerMax;   // inside is accepted
+    };
+
+    bool acceptsSlow(float angle, float dist) const;
+    bool inSector(float angle) const;
+
+    bool mEmpty = true;
+    AreaMask mArea;
+    float mX = 0, mY = 0, mAngle = 0;
+    std::vector<Bin> mBins;
+};
@@ -0,0 +1,77 @@
+#include "ScanFilter.h"
+#include "Trace.h"
+
+#include <math.h>
+#include <algorithm>
+
+ScanFilter::Option::Option()
+{
+    minQuality = 0;
+    isolationDistance = 0;
+    window = 2;
+    minNeighbours = 1;
+    edgeJump = 0;
+}
+
+size_t ScanFilter::apply(std::vector<LidarScanPoint> &scan, const Option &option)
+{
+    TRACE_SCOPE("ScanFilter::apply");
+
+    const int n = (int)scan.size();
+    if (n == 0) return 0;
+    if (option.minQuality <= 0 && option.isolationDistance <= 0 && option.edgeJump <= 0) return 0;
+
+    // decide on the unfiltered scan, then apply, so that one rejection does not cascade
+    mReject.assign(n, 0);
+    const int window = std::max(std::min(option.window, n / 2), 1);
+    for (int i = 0; i < n; i++)
+    {
+        const LidarScanPoint &pt = scan[i];
+        if (!pt.valid) continue;
+
+        if (pt.quality < option.minQuality)
+        {
+            mReject[i] = 1;
+            continue;
+        }
+
+        if (option.isolationDistance > 0)
+        {
+            // the scan covers a full turn, so neighbours wrap around
+            int neighbours = 0;
+            for (int k = -window; k <= window && neighbours < option.minNeighbours; k++)
+            {
+                if (k == 0) continue;
+                const LidarScanPoint &other = scan[(i + k + n) % n];
+                if (other.valid && fabsf(other.dist - pt.dist) < option.isolationDistance) neighbours++;
+            }
+            if (neighbours < option.minNeighbours)
+            {
+                mReject[i] = 1;
+                continue;
+            }
+        }
+
+        if (option.edgeJump > 0)
+        {
+            const LidarScanPoint &prev = scan[(i + n - 1) % n];
+            const LidarScanPoint &next = scan[(i + 1) % n];
+            if (prev.valid && next.valid
+                && (pt.dist - prev.dist) * (next.dist - pt.dist) > 0
+                && fabsf(pt.dist - prev.dist) > option.edgeJump
+                && fabsf(next.dist - pt.dist) > option.edgeJump)
+            {
+                mReject[i] = 1;
+            }
+        }
+    }
+
+    size_t rejected = 0;
+    for (int i = 0; i < n; i++)
+    {
+        if (!mReject[i]) continue;
+        scan[i].valid = false;
+        rejected++;
+    }
+    return rejected;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "../LidarDevice/LidarDevice.h"
+
+// Removes speckle from a raw scan before it reaches detection, in one pass
+// over the angle ordered points. Rejected points are only marked invalid so
+// the buffer keeps its size and order.
+//
+// - quality: drops returns below minQuality
+// - isolation: drops points without minNeighbours angular neighbours (within
+//   +-window samples) closer than isolationDistance in range, e.g. dust
+// - edge: drops "mixed pixels", whose range sits between a foreground and a
+//   background neighbour, more than edgeJump away from both
+class ScanFilter
+{
+public:
+    struct Option
+    {
+        Option();
+        int minQuality;             // 0 to disable
+        float isolationDistance;    // millimeter, 0 to disable
+        int window;
+        int minNeighbours;
+        float edgeJump;             // millimeter, 0 to disable
+    };
+
+    // Returns the number of points it invalidated.
+    size_t apply(std::vector<LidarScanPoint> &scan, const Option &option);
+
+private:
+    std::vector<uint8_t> mReject;
+};
@@ -0,0 +1,341 @@
+#include "ScanPipeline.h"
+#include "Trace.h"
+#include "AllocCounter.h"
+
+#include <math.h>
+#include <float.h>
+#include <algorithm>
+
+ScanPipeline::Option::Option()
+{
+    mmToPixel = 0.1f;
+    baseAngle = 0;
+    dotRadius = 30;
+    frontRadius = 3;
+    clusterDistance = 0;
+    bitRaster = false;
+    diffImage = true;
+    accumulateScans = 1;
+    gateDistance = 0;
+    coarseToFine = true;
+    redrawTolerance = 1;
+}
+
+namespace
+{
+    void setRotatedBox(Blob &obj, Point2f center, float width, float height, float rad)
+    {
+        obj.rotBox = RotatedRect(center, cv::Size2f(width, height), rad * cv::GRAD_PI);
+        obj.angle = (90 - obj.rotBox.angle) * cv::GRAD_PI2; // same convention as BlobFinder
+        obj.length = 2 * (width + height);
+
+        float c = cos(rad), s = sin(rad);
+        const float corners[4][2] = { { -1, -1 }, { 1, -1 }, { 1, 1 }, { -1, 1 } };
+        for (const auto &corner : corners)
+        {
+            float u = corner[0] * width / 2, v = corner[1] * height / 2;
+            obj.pts.push_back(Point((int)(center.x + u * c - v * s), (int)(center.y + u * s + v * c)));
+        }
+    }
+}
+
+void ScanPipeline::setup(int width, int height)
+{
+    mWidth = width;
+    mHeight = height;
+    frontMat = cv::Mat1b(height, width);
+    diffMat = cv::Mat1b(height, width);
+    mPointRaster.setup(width, height);
+    mHistory.clear();
+    mIncremental.reset();
+    mDiffRows.clear();
+    mFrontRows.clear();
+}
+
+void ScanPipeline::rasterize(const std::vector<LidarScanPoint> &scanData, const Option &option)
+{
+    ALLOC_STAGE(STAGE_DETECTION);
+    {
+        TRACE_SCOPE("project");
+        worldPoints.clear();
+        for (const auto &scanPoint : scanData)
+        {
+            if (!scanPoint.valid) continue;
+            float rad = (float)(scanPoint.angle * 3.1415 / 180.0);
+            worldPoints.emplace_back(Point2f(sin(rad) * scanPoint.dist, cos(rad) * scanPoint.dist));
+        }
+    }
+    rasterize(worldPoints, option);
+}
+
+void ScanPipeline::rasterize(const std::vector<Point2f> &world, const Option &option)
+{
+    ALLOC_STAGE(STAGE_DETECTION);
+    {
+        TRACE_SCOPE("project");
+        float cx = mWidth / 2.0f;
+        float cy = mHeight / 2.0f;
+        float rad = (float)(option.baseAngle * 3.1415 / 180.0);
+        float c = cos(rad) * option.mmToPixel;
+        float s = sin(rad) * option.mmToPixel;
+        points.clear();
+        for (const auto &pt : world)
+        {
+            int x = pt.x * c - pt.y * s + cx;
+            int y = cy - (pt.y * c + pt.x * s);
+            points.emplace_back(Point(x, y));
+        }
+    }
+
+    // detect() uses them whenever they are not empty, also in bitRaster mode
+    mCoarseRects.clear();
+    if (option.bitRaster)
+    {
+        TRACE_SCOPE("rasterize");
+        // the mats no longer hold what the cv path drew
+        mIncremental.reset();
+        mPointRaster.clear();
+        for (const auto &pt : points) mPointRaster.set(pt.x, pt.y);
+
+        const BitRaster *source = &mPointRaster;
+        if (option.accumulateScans > 1)
+        {
+            accumulate(option);
+            source = &mAccumRaster;
+            if (option.gateDistance > 0)
+            {
+                // drop the trail of whatever moved since
+                mPointRaster.dilate((int)(option.gateDistance * option.mmToPixel), mGateRaster);
+                mGatedRaster.intersect(mAccumRaster, mGateRaster);
+                source = &mGatedRaster;
+            }
+        }
+        source->dilate((int)option.dotRadius, mDiffRaster);
+        if (option.diffImage) mDiffRaster.unpack(diffMat.ptr(), diffMat.step, 255, &mDiffRows);
+        else mDiffRows.clear();
+        if (option.frontRadius > 0)
+        {
+            mPointRaster.dilate((int)option.frontRadius, mFrontRaster);
+            mFrontRaster.unpack(frontMat.ptr(), frontMat.step, 255, &mFrontRows);
+        }
+        else
+        {
+            mFrontRows.clear();
+        }
+        return;
+    }
+
+    if (option.coarseToFine && !option.finder.handOnlyMode)
+    {
+        TRACE_SCOPE("coarse regions");
+        findCoarseRegions(option);
+    }
+
+    {
+        TRACE_SCOPE("rasterize");
+        mDiffRows.clear();
+        mFrontRows.clear();
+        mIncremental.draw(points, diffMat, (int)option.dotRadius,
+            option.frontRadius > 0 ? &frontMat : nullptr, (int)option.frontRadius, option.redrawTolerance);
+    }
+}
+
+Point2f ScanPipeline::toWorld(const Point2f &pixel, int width, int height, const Option &option)
+{
+    float rad = (float)(option.baseAngle * 3.1415 / 180.0);
+    float x = (pixel.x - width / 2.0f) / option.mmToPixel;
+    float y = (height / 2.0f - pixel.y) / option.mmToPixel;
+    return Point2f(x * cos(rad) + y * sin(rad), y * cos(rad) - x * sin(rad));
+}
+
+void ScanPipeline::findCoarseRegions(const Option &option)
+{
+    // Points whose disks touch belong to the same blob, so the groups of a
+    // coarse grid with that cell size bound every blob. Boxes that overlap
+    // are merged so that no contour is traced twice.
+    const int pad = (int)option.dotRadius + 2;
+    mClusterer.execute(points.data(), points.size(), 2.0f * pad);
+
+    const Rect frame(0, 0, mWidth, mHeight);
+    for (const auto &cluster : mClusterer.getClusters())
+    {
+        Rect rc((int)cluster.minX - pad, (int)cluster.minY - pad,
+            (int)(cluster.maxX - cluster.minX) + 2 * pad + 1, (int)(cluster.maxY - cluster.minY) + 2 * pad + 1);
+        rc &= frame;
+        if (rc.width > 0 && rc.height > 0) mCoarseRects.push_back(rc);
+    }
+
+    for (bool merged = true; merged;)
+    {
+        merged = false;
+        for (size_t i = 0; i < mCoarseRects.size() && !merged; i++)
+        {
+            for (size_t j = i + 1; j < mCoarseRects.size(); j++)
+            {
+                if ((mCoarseRects[i] & mCoarseRects[j]).area() == 0) continue;
+                mCoarseRects[i] |= mCoarseRects[j];
+                mCoarseRects.erase(mCoarseRects.begin() + j);
+                merged = true;
+                break;
+            }
+        }
+    }
+}
+
+void ScanPipeline::accumulate(const Option &option)
+{
+    TRACE_SCOPE("accumulate");
+    const int capacity = option.accumulateScans;
+    if ((int)mHistory.size() != capacity)
+    {
+        mHistory.assign(capacity, std::vector<Point>());
+        mHistoryHead = 0;
+        mHistoryCount = 0;
+        mHitCount.assign((size_t)mWidth * mHeight, 0);
+        mAccumRaster.setup(mWidth, mHeight);
+    }
+
+    auto inside = [this](const Point &pt) {
+        return pt.x >= 0 && pt.y >= 0 && pt.x < mWidth && pt.y < mHeight;
+    };
+
+    // the slot at the head is the oldest scan once the ring is full
+    std::vector<Point> &slot = mHistory[mHistoryHead];
+    if (mHistoryCount == capacity)
+    {
+        for (const auto &pt : slot)
+        {
+            if (!inside(pt) || --mHitCount[pt.y * mWidth + pt.x] == 0) mAccumRaster.reset(pt.x, pt.y);
+        }
+    }
+    else
+    {
+        mHistoryCount++;
+    }
+
+    slot.assign(points.begin(), points.end());
+    for (const auto &pt : slot)
+    {
+        if (!inside(pt) || mHitCount[pt.y * mWidth + pt.x]++ == 0) mAccumRaster.set(pt.x, pt.y);
+    }
+    mHistoryHead = (mHistoryHead + 1) % capacity;
+}
+
+void ScanPipeline::detect(const Option &option)
+{
+    ALLOC_STAGE(STAGE_DETECTION);
+    if (option.clusterDistance > 0)
+    {
+        TRACE_SCOPE("PointClusterer::execute");
+        findClusters(option);
+    }
+    else if (option.bitRaster && !option.finder.handOnlyMode)
+    {
+        TRACE_SCOPE("BitRaster::label");
+        findRegions(option);
+    }
+    else if (!mCoarseRects.empty())
+    {
+        TRACE_SCOPE("BlobFinder::execute");
+        blobs.clear();
+        for (const auto &rc : mCoarseRects)
+        {
+            cv::Mat roi(diffMat, rc);
+            mFinder.execute(roi, option.finder, mRoiBlobs);
+            for (auto &blob : mRoiBlobs)
+            {
+                // back to full raster coordinates
+                const Point offset(rc.x, rc.y);
+                blob.box.x += rc.x;
+                blob.box.y += rc.y;
+                blob.center += Point2f((float)rc.x, (float)rc.y);
+                blob.rotBox.center += Point2f((float)rc.x, (float)rc.y);
+                for (auto &pt : blob.pts) pt += offset;
+                blobs.next() = blob;
+            }
+        }
+        if (!blobs.empty())
+            std::sort(blobs.begin(), blobs.end(), option.finder.sort_func);
+    }
+    else
+    {
+        TRACE_SCOPE("BlobFinder::execute");
+        mFinder.execute(diffMat, option.finder, blobs);
+    }
+    {
+        TRACE_SCOPE("BlobTracker::trackBlobs");
+        ALLOC_STAGE(STAGE_TRACKING);
+        tracker.trackBlobs(blobs);
+    }
+}
+
+void ScanPipeline::findClusters(const Option &option)
+{
+    blobs.clear();
+    mClusterer.execute(points.data(), points.size(), option.clusterDistance * option.mmToPixel);
+
+    // same footprint as the raster path: every point grows by dotRadius
+    const float pad = option.dotRadius;
+    const auto &indices = mClusterer.getIndices();
+    for (const auto &cluster : mClusterer.getClusters())
+    {
+        // extent along the principal axis for the rotated box
+        float c = cos(cluster.angle), s = sin(cluster.angle);
+        float minU = FLT_MAX, maxU = -FLT_MAX, minV = FLT_MAX, maxV = -FLT_MAX;
+        for (uint32_t k = cluster.first; k < cluster.first + cluster.count; k++)
+        {
+            const Point &pt = points[indices[k]];
+            float u = pt.x * c + pt.y * s;
+            float v = pt.y * c - pt.x * s;
+            minU = std::min(minU, u);
+            maxU = std::max(maxU, u);
+            minV = std::min(minV, v);
+            maxV = std::max(maxV, v);
+        }
+        float width = maxU - minU + 2 * pad;
+        float height = maxV - minV + 2 * pad;
+        float area = width * height;
+        if (area < option.finder.minArea || area > option.finder.maxArea) continue;
+
+        Blob &obj = blobs.next();
+        float u = (minU + maxU) / 2, v = (minV + maxV) / 2;
+        setRotatedBox(obj, Point2f(u * c - v * s, u * s + v * c), width, height, cluster.angle);
+        obj.area = area;
+        obj.box = Rect((int)(cluster.minX - pad), (int)(cluster.minY - pad),
+            (int)(cluster.maxX - cluster.minX + 2 * pad), (int)(cluster.maxY - cluster.minY + 2 * pad));
+        obj.center = Point2f(cluster.centerX, cluster.centerY);
+    }
+
+    if (!blobs.empty())
+        std::sort(blobs.begin(), blobs.end(), option.finder.sort_func);
+}
+
+void ScanPipeline::findRegions(const Option &option)
+{
+    blobs.clear();
+    mDiffRaster.label(mRegions);
+    for (const auto &region : mRegions)
+    {
+        if (region.area < option.finder.minArea || region.area > option.finder.maxArea) continue;
+
+        Blob &obj = blobs.next();
+        double n = region.area;
+        double cx = region.sumX / n, cy = region.sumY / n;
+        double mu20 = region.sumXX / n - cx * cx;
+        double mu02 = region.sumYY / n - cy * cy;
+        double mu11 = region.sumXY / n - cx * cy;
+
+        // box of the equivalent ellipse, full axis = 4 * sqrt(eigenvalue)
+        double half = (mu20 + mu02) / 2;
+        double root = sqrt((mu20 - mu02) * (mu20 - mu02) / 4 + mu11 * mu11);
+        float rad = (float)(0.5 * atan2(2 * mu11, mu20 - mu02));
+        setRotatedBox(obj, Point2f((float)cx, (float)cy),
+            (float)(4 * sqrt(half + root)), (float)(4 * sqrt(std::max(half - root, 0.0))), rad);
+        obj.area = (float)n;
+        obj.box = Rect(region.minX, region.minY, region.maxX - region.minX + 1, region.maxY - region.minY + 1);
+        obj.center = Point2f((float)cx, (float)cy);
+    }
+
+    if (!blobs.empty())
+        std::sort(blobs.begin(), blobs.end(), option.finder.sort_func);
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <vector>
+
+#include "BlobTracker.h"
+#include "PointClusterer.h"
+#include "BitRaster.h"
+#include "IncrementalRaster.h"
+#include "../LidarDevice/LidarDevice.h"
+
+// Turns lidar scans into tracked blobs: projects the scan points into a
+// width x height raster, finds the blobs in it and feeds BlobTracker.
+// By default the raster is a BitRaster and blobs come from its connected
+// components; diffMat is then only filled for display.
+// Shared by the app and the embedding library, so it does not depend on
+// cinder or on the MiniConfig globals. Each instance owns its scratch
+// buffers, so separate pipelines can run on separate threads.
+class ScanPipeline
+{
+public:
+    struct Option
+    {
+        Option();
+        float mmToPixel;
+        float baseAngle;        // in degree
+        float dotRadius;        // in pixel, radius of each point in diffMat
+        float frontRadius;      // in pixel, radius of each point in frontMat, 0 to skip it
+        float clusterDistance;  // in millimeter, > 0 clusters the points instead of running BlobFinder
+        bool bitRaster;         // 1 bit per pixel raster and region labeling instead of cv::circle + BlobFinder
+        bool diffImage;         // fill diffMat in bitRaster mode, only needed for display
+        int accumulateScans;    // bitRaster only, rasterize the points of the last N scans
+        float gateDistance;     // in millimeter, older points are kept only this close to the latest scan, 0 keeps all
+        bool coarseToFine;      // without bitRaster, only draw and trace contours inside the regions around point groups
+        float redrawTolerance;  // in pixel, without bitRaster only redraw raster tiles whose points moved further, < 0 redraws all
+        BlobFinder::Option finder;
+    };
+
+    void setup(int width, int height);
+
+    // project + rasterize
+    void rasterize(const std::vector<LidarScanPoint> &scanData, const Option &option);
+
+    // Same for points already in world coordinates (millimeter, x right, y forward),
+    // e.g. from LidarFusion. option.baseAngle still rotates the whole set.
+    void rasterize(const std::vector<Point2f> &world, const Option &option);
+
+    // Regions of the bit raster, BlobFinder on diffMat, or PointClusterer on
+    // the points when option.clusterDistance is set, then BlobTracker
+    void detect(const Option &option);
+
+    void process(const std::vector<LidarScanPoint> &scanData, const Option &option)
+    {
+        rasterize(scanData, option);
+        detect(option);
+    }
+
+    // Inverse of the projection in rasterize(), pixel to world millimeter.
+    Point2f toWorld(const Point2f &pixel, const Option &option) const { return toWorld(pixel, mWidth, mHeight, option); }
+    // Same for a width x height raster, without touching a pipeline that runs on another thread.
+    static Point2f toWorld(const Point2f &pixel, int width, int height, const Option &option);
+
+    int getWidth() const { return mWidth; }
+    int getHeight() const { return mHeight; }
+
+    cv::Mat1b frontMat, diffMat;
+    std::vector<Point> points;
+    std::vector<Point2f> worldPoints;
+    BlobList blobs;
+    BlobTracker tracker;
+
+private:
+    void findClusters(const Option &option);
+    void findRegions(const Option &option);
+    void accumulate(const Option &option);
+    void findCoarseRegions(const Option &option);
+
+    BlobFinder mFinder;
+    BlobList mRoiBlobs;
+    PointClusterer mClusterer;
+    BitRaster mPointRaster, mDiffRaster, mFrontRaster;
+    std::vector<BitRaster::Region> mRegions;
+
+    // last accumulateScans point sets in a ring, and how many of them hit
+    // each pixel, so that a scan is added and expired without redoing the others
+    std::vector<std::vector<Point>> mHistory;
+    int mHistoryHead = 0;
+    int mHistoryCount = 0;
+    std::vector<uint16_t> mHitCount;
+    BitRaster mAccumRaster, mGateRaster, mGatedRaster;
+
+    // what is currently in diffMat / frontMat, so that only the changed parts get cleared
+    IncrementalRaster mIncremental;
+    std::vector<uint8_t> mDiffRows, mFrontRows;
+
+    // coarseToFine regions of diffMat, empty when the whole raster is used
+    std::vector<Rect> mCoarseRects;
+    int mWidth = 0;
+    int mHeight = 0;
+};
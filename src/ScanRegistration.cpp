@@ -0,0 +1,294 @@
+#include "ScanRegistration.h"
+#include "Trace.h"
+
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+    const int kBinCount = 720;   // 0.5 degree bins
+
+    // Farthest valid range per angle bin over several scans.
+    struct Background
+    {
+        float range[kBinCount];
+
+        Background()
+        {
+            std::fill(range, range + kBinCount, 0.0f);
+        }
+
+        void add(const std::vector<LidarScanPoint> &scan)
+        {
+            for (const auto &pt : scan)
+            {
+                if (!pt.valid) continue;
+                float a = fmodf(pt.angle, 360.0f);
+                if (a < 0) a += 360.0f;
+                int bin = std::min((int)(a * kBinCount / 360.0f), kBinCount - 1);
+                range[bin] = std::max(range[bin], pt.dist);
+            }
+        }
+
+        // device frame, ordered by angle
+        void toPoints(std::vector<cv::Point2f> &points) const
+        {
+            points.clear();
+            for (int bin = 0; bin < kBinCount; bin++)
+            {
+                if (range[bin] <= 0) continue;
+                float rad = (bin + 0.5f) * 2 * (float)CV_PI / kBinCount;
+                points.emplace_back(sinf(rad) * range[bin], cosf(rad) * range[bin]);
+            }
+        }
+    };
+
+    inline cv::Point2f transform(const LidarPose &pose, const cv::Point2f &pt)
+    {
+        float rad = pose.angle * (float)CV_PI / 180;
+        float c = cosf(rad), s = sinf(rad);
+        return cv::Point2f(pose.x + c * pt.x - s * pt.y, pose.y + s * pt.x + c * pt.y);
+    }
+
+    // Uniform grid over the target points, cells sorted by key for lookup without hashing.
+    struct GridIndex
+    {
+        float invCell;
+        std::vector<std::pair<int64_t, int>> cells;
+
+        static int64_t key(int64_t cx, int64_t cy)
+        {
+            return (cx << 32) ^ (cy & 0xffffffff);
+        }
+
+        void build(const std::vector<cv::Point2f> &points, float cellSize)
+        {
+            invCell = 1 / cellSize;
+            cells.clear();
+            for (int i = 0; i < (int)points.size(); i++)
+            {
+                cells.emplace_back(key((int64_t)floorf(points[i].x * invCell), (int64_t)floorf(points[i].y * invCell)), i);
+            }
+            std::sort(cells.begin(), cells.end());
+        }
+
+        int nearest(const std::vector<cv::Point2f> &points, const cv::Point2f &pt, float maxDistSq) const
+        {
+            int64_t cx = (int64_t)floorf(pt.x * invCell);
+            int64_t cy = (int64_t)floorf(pt.y * invCell);
+            int best = -1;
+            float bestDistSq = maxDistSq;
+            for (int64_t dy = -1; dy <= 1; dy++)
+            {
+                for (int64_t dx = -1; dx <= 1; dx++)
+                {
+                    auto first = std::lower_bound(cells.begin(), cells.end(), std::make_pair(key(cx + dx, cy + dy), -1));
+                    for (auto it = first; it != cells.end() && it->first == key(cx + dx, cy + dy); ++it)
+                    {
+                        cv::Point2f d = points[it->second] - pt;
+                        float distSq = d.x * d.x + d.y * d.y;
+                        if (distSq < bestDistSq)
+                        {
+                            bestDistSq = distSq;
+                            best = it->second;
+                        }
+                    }
+                }
+            }
+            return best;
+        }
+    };
+}
+
+ScanRegistration::Option::Option()
+{
+    backgroundScans = 20;
+    maxDistance = 200;
+    maxIterations = 50;
+    minInlierRatio = 0.3f;
+}
+
+ScanRegistration::~ScanRegistration()
+{
+    mCancel = true;
+    if (mThread.joinable()) mThread.join();
+}
+
+void ScanRegistration::request(LidarFusion &fusion, const Option &option)
+{
+    if (mBusy) return;
+    if (mThread.joinable()) mThread.join();
+    mBusy = true;
+    mCancel = false;
+    mThread = std::thread(&ScanRegistration::run, this, &fusion, option);
+}
+
+bool ScanRegistration::poll(Result &result)
+{
+    std::lock_guard<std::mutex> lock(mResultMutex);
+    if (!mHasResult) return false;
+    result = mResult;
+    mHasResult = false;
+    return true;
+}
+
+bool ScanRegistration::align(const std::vector<cv::Point2f> &target, const std::vector<cv::Point2f> &source,
+                             LidarPose &pose, const Option &option, float *rms)
+{
+    if (target.size() < 3 || source.empty()) return false;
+
+    // target normals from the neighbours in angle order, skipped across gaps
+    std::vector<cv::Point2f> normals(target.size(), cv::Point2f(0, 0));
+    float maxGapSq = option.maxDistance * option.maxDistance;
+    for (size_t i = 1; i + 1 < target.size(); i++)
+    {
+        cv::Point2f d = target[i + 1] - target[i - 1];
+        float lenSq = d.x * d.x + d.y * d.y;
+        if (lenSq == 0 || lenSq > 4 * maxGapSq) continue;
+        float invLen = 1 / sqrtf(lenSq);
+        normals[i] = cv::Point2f(-d.y * invLen, d.x * invLen);
+    }
+
+    GridIndex grid;
+    grid.build(target, option.maxDistance);
+
+    // structure of arrays so the accumulation loop vectorizes
+    std::vector<float> px(source.size()), py(source.size()), nx(source.size()), ny(source.size()), r(source.size());
+
+    float rad = pose.angle * (float)CV_PI / 180;
+    float tx = pose.x, ty = pose.y;
+    float inlierRatio = 0;
+    float error = 0;
+    for (int iteration = 0; iteration < option.maxIterations; iteration++)
+    {
+        // correspondences
+        float c = cosf(rad), s = sinf(rad);
+        size_t n = 0;
+        for (const auto &pt : source)
+        {
+            cv::Point2f p(tx + c * pt.x - s * pt.y, ty + s * pt.x + c * pt.y);
+            int j = grid.nearest(target, p, maxGapSq);
+            if (j < 0 || (normals[j].x == 0 && normals[j].y == 0)) continue;
+            px[n] = p.x;
+            py[n] = p.y;
+            nx[n] = normals[j].x;
+            ny[n] = normals[j].y;
+            r[n] = (p.x - target[j].x) * normals[j].x + (p.y - target[j].y) * normals[j].y;
+            n++;
+        }
+        inlierRatio = (float)n / source.size();
+        if (n < 3) return false;
+
+        // Gauss-Newton step for (dx, dy, dtheta), rotation about the world origin
+        float a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+        float b0 = 0, b1 = 0, b2 = 0, sumSq = 0;
+        for (size_t i = 0; i < n; i++)
+        {
+            float j2 = ny[i] * px[i] - nx[i] * py[i];
+            a00 += nx[i] * nx[i];
+            a01 += nx[i] * ny[i];
+            a02 += nx[i] * j2;
+            a11 += ny[i] * ny[i];
+            a12 += ny[i] * j2;
+            a22 += j2 * j2;
+            b0 -= nx[i] * r[i];
+            b1 -= ny[i] * r[i];
+            b2 -= j2 * r[i];
+            sumSq += r[i] * r[i];
+        }
+        error = sqrtf(sumSq / n);
+
+        // solve the symmetric 3x3 system with Cramer's rule
+        float det = a00 * (a11 * a22 - a12 * a12) - a01 * (a01 * a22 - a12 * a02) + a02 * (a01 * a12 - a11 * a02);
+        if (fabsf(det) < 1e-9f) return false;
+        float dx = (b0 * (a11 * a22 - a12 * a12) - a01 * (b1 * a22 - a12 * b2) + a02 * (b1 * a12 - a11 * b2)) / det;
+        float dy = (a00 * (b1 * a22 - a12 * b2) - b0 * (a01 * a22 - a12 * a02) + a02 * (a01 * b2 - b1 * a02)) / det;
+        float dt = (a00 * (a11 * b2 - b1 * a12) - a01 * (a01 * b2 - b1 * a02) + b0 * (a01 * a12 - a11 * a02)) / det;
+
+        float dc = cosf(dt), ds = sinf(dt);
+        float ntx = dc * tx - ds * ty + dx;
+        float nty = ds * tx + dc * ty + dy;
+        tx = ntx;
+        ty = nty;
+        rad += dt;
+
+        if (fabsf(dx) < 0.1f && fabsf(dy) < 0.1f && fabsf(dt) < 1e-4f) break;
+    }
+
+    if (rms) *rms = error;
+    if (inlierRatio < option.minInlierRatio) return false;
+
+    pose.x = tx;
+    pose.y = ty;
+    pose.angle = rad * 180 / (float)CV_PI;
+    return true;
+}
+
+void ScanRegistration::run(LidarFusion *fusion, Option option)
+{
+    TRACE_THREAD_NAME("scan registration");
+
+    size_t deviceCount = fusion->getDeviceCount();
+    std::vector<Background> backgrounds(deviceCount);
+    std::vector<uint64_t> sequences(deviceCount, 0);
+    std::vector<int> scanCounts(deviceCount, 0);
+    std::vector<LidarScanPoint> scan;
+
+    // collect backgrounds without holding up the acquisition threads
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    bool collecting = true;
+    while (collecting && !mCancel && std::chrono::steady_clock::now() < deadline)
+    {
+        collecting = false;
+        for (size_t d = 0; d < deviceCount; d++)
+        {
+            if (scanCounts[d] >= option.backgroundScans) continue;
+            collecting = true;
+            uint64_t sequence;
+            if (fusion->copyLatestScan(d, scan, &sequence) && sequence != sequences[d])
+            {
+                sequences[d] = sequence;
+                backgrounds[d].add(scan);
+                scanCounts[d]++;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    Result result;
+    result.poses.resize(deviceCount);
+    result.rms.assign(deviceCount, 0.0f);
+    result.converged.assign(deviceCount, false);
+    for (size_t d = 0; d < deviceCount; d++)
+    {
+        result.poses[d] = fusion->getPose(d);
+    }
+
+    if (deviceCount > 0 && !mCancel)
+    {
+        TRACE_SCOPE("ScanRegistration::align");
+        std::vector<cv::Point2f> target, source;
+        backgrounds[0].toPoints(source);
+        for (auto &pt : source) target.push_back(transform(result.poses[0], pt));
+        result.converged[0] = true;
+
+        for (size_t d = 1; d < deviceCount; d++)
+        {
+            backgrounds[d].toPoints(source);
+            LidarPose pose = result.poses[d];
+            if (align(target, source, pose, option, &result.rms[d]))
+            {
+                result.poses[d] = pose;
+                result.converged[d] = true;
+            }
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mResultMutex);
+        mResult = result;
+        mHasResult = !mCancel;
+    }
+    mBusy = false;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "LidarFusion.h"
+
+// Estimates the pose of every lidar relative to the first one by matching
+// their static backgrounds with point-to-line ICP.
+//
+// A pass runs on its own thread: it collects a few scans of every device,
+// keeps the farthest range per angle bin as background (people and other
+// moving objects are always in front of it), then aligns each background
+// onto the reference one starting from the current pose.
+class ScanRegistration
+{
+public:
+    struct Option
+    {
+        Option();
+        int backgroundScans;        // scans merged into each background
+        float maxDistance;          // millimeter, correspondences farther apart are ignored
+        int maxIterations;
+        float minInlierRatio;       // below that the pose is not trusted
+    };
+
+    struct Result
+    {
+        std::vector<LidarPose> poses;
+        std::vector<float> rms;         // millimeter, point-to-line
+        std::vector<bool> converged;    // false poses are left untouched
+    };
+
+    ~ScanRegistration();
+
+    // Starts a background pass, ignored while one is running.
+    void request(LidarFusion &fusion, const Option &option);
+    bool isBusy() const { return mBusy; }
+
+    // Returns true once with the result of a finished pass.
+    bool poll(Result &result);
+
+    // Point-to-line ICP of source (device frame) onto target (world frame,
+    // ordered by angle). pose is the initial guess and receives the estimate.
+    static bool align(const std::vector<cv::Point2f> &target, const std::vector<cv::Point2f> &source,
+                      LidarPose &pose, const Option &option, float *rms);
+
+private:
+    void run(LidarFusion *fusion, Option option);
+
+    std::thread mThread;
+    std::atomic<bool> mBusy{ false };
+    std::atomic<bool> mCancel{ false };
+
+    std::mutex mResultMutex;
+    bool mHasResult = false;
+    Result mResult;
+};
@@ -0,0 +1,125 @@
+#include "ShmPublisher.h"
+
+#include <string.h>
+#include <algorithm>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+void fillMasBlob(mas_blob &out, const TrackedBlobTable &blobs, size_t row)
+{
+    out.id = blobs.id[row];
+    out.center_x = blobs.center[row].x;
+    out.center_y = blobs.center[row].y;
+    out.velocity_x = blobs.velocity[row].x;
+    out.velocity_y = blobs.velocity[row].y;
+    out.box_x = blobs.box[row].x;
+    out.box_y = blobs.box[row].y;
+    out.box_width = blobs.box[row].width;
+    out.box_height = blobs.box[row].height;
+    out.rot_center_x = blobs.rotBox[row].center.x;
+    out.rot_center_y = blobs.rotBox[row].center.y;
+    out.rot_width = blobs.rotBox[row].size.width;
+    out.rot_height = blobs.rotBox[row].size.height;
+    out.rot_angle = blobs.rotBox[row].angle;
+    out.area = blobs.area[row];
+}
+
+ShmPublisher::~ShmPublisher()
+{
+    close();
+}
+
+bool ShmPublisher::open(const std::string &name)
+{
+    close();
+
+    void *p = nullptr;
+#if defined(_WIN32)
+    // the POSIX style leading slash is not valid in a kernel object name
+    std::string objectName = "Local\\" + name.substr(name.find_first_not_of('/'));
+    mMapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, sizeof(mas_shm_header), objectName.c_str());
+    if (!mMapping) return false;
+    p = MapViewOfFile(mMapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(mas_shm_header));
+    if (!p)
+    {
+        CloseHandle(mMapping);
+        mMapping = nullptr;
+        return false;
+    }
+#else
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+    if (fd < 0) return false;
+    if (ftruncate(fd, sizeof(mas_shm_header)) != 0)
+    {
+        ::close(fd);
+        return false;
+    }
+    p = mmap(nullptr, sizeof(mas_shm_header), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) return false;
+#endif
+
+    mShm = (mas_shm_header *)p;
+    // invalidate first so that readers of a stale segment back off while we reset it
+    mShm->magic = 0;
+    MAS_SHM_BARRIER();
+    memset(mShm->slots, 0, sizeof(mShm->slots));
+    mShm->version = MAS_SHM_VERSION;
+    mShm->slot_count = MAS_SHM_SLOT_COUNT;
+    mShm->max_blobs = MAS_SHM_MAX_BLOBS;
+    mShm->latest_frame = 0;
+    MAS_SHM_BARRIER();
+    mShm->magic = MAS_SHM_MAGIC;
+
+    mName = name;
+    mFrame = 0;
+    return true;
+}
+
+void ShmPublisher::close()
+{
+    if (!mShm) return;
+#if defined(_WIN32)
+    UnmapViewOfFile(mShm);
+    CloseHandle(mMapping);
+    mMapping = nullptr;
+#else
+    munmap(mShm, sizeof(mas_shm_header));
+    shm_unlink(mName.c_str());
+#endif
+    mShm = nullptr;
+    mName.clear();
+}
+
+void ShmPublisher::publish(const TrackedBlobTable &blobs, int frameWidth, int frameHeight, uint64_t timestampUs)
+{
+    if (!mShm) return;
+
+    uint32_t frame = ++mFrame;
+    mas_shm_slot &slot = mShm->slots[frame % MAS_SHM_SLOT_COUNT];
+
+    slot.seq = slot.seq + 1;
+    MAS_SHM_BARRIER();
+
+    slot.frame = frame;
+    slot.timestamp_us = timestampUs;
+    slot.frame_width = frameWidth;
+    slot.frame_height = frameHeight;
+    uint32_t count = (uint32_t)std::min(blobs.size(), (size_t)MAS_SHM_MAX_BLOBS);
+    slot.blob_count = count;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        fillMasBlob(slot.blobs[i], blobs, i);
+    }
+
+    MAS_SHM_BARRIER();
+    slot.seq = slot.seq + 1;
+    MAS_SHM_BARRIER();
+    mShm->latest_frame = frame;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "MiniAreaScanShm.h"
+#include "BlobTracker.h"
+
+void fillMasBlob(mas_blob &out, const TrackedBlobTable &blobs, size_t row);
+
+// Writer side of the shared-memory blob output, see MiniAreaScanShm.h.
+class ShmPublisher
+{
+public:
+    ~ShmPublisher();
+
+    bool open(const std::string &name);
+    void close();
+    bool isOpen() const { return mShm != nullptr; }
+    const std::string &getName() const { return mName; }
+
+    void publish(const TrackedBlobTable &blobs, int frameWidth, int frameHeight, uint64_t timestampUs);
+
+private:
+    std::string mName;
+    mas_shm_header *mShm = nullptr;
+    uint32_t mFrame = 0;
+#if defined(_WIN32)
+    void *mMapping = nullptr;
+#endif
+};
@@ -0,0 +1,146 @@
+#include "Trace.h"
+
+#if defined(MINIAREASCAN_TRACE)
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <stdio.h>
+
+namespace
+{
+    struct TraceEvent
+    {
+        std::atomic<uint64_t> seq; // index + 1 once the slot is fully written, 0 while being written
+        const char *name;
+        uint32_t tid;
+        uint64_t startUs;
+        uint64_t durUs;
+    };
+
+    const uint64_t kCapacity = 1 << 16;
+    const uint64_t kMask = kCapacity - 1;
+
+    TraceEvent sEvents[kCapacity];
+    std::atomic<uint64_t> sHead(0);
+    std::atomic<bool> sEnabled(false);
+    std::atomic<uint32_t> sNextTid(1);
+
+    std::mutex sThreadNameMutex;
+    std::vector<std::pair<uint32_t, std::string>> sThreadNames;
+
+    const std::chrono::steady_clock::time_point sEpoch = std::chrono::steady_clock::now();
+
+    uint32_t currentTid()
+    {
+        static thread_local uint32_t tid = sNextTid.fetch_add(1);
+        return tid;
+    }
+
+    void writeEscaped(FILE *fp, const char *str)
+    {
+        for (; *str; str++)
+        {
+            if (*str == '"' || *str == '\\') fputc('\\', fp);
+            fputc(*str, fp);
+        }
+    }
+}
+
+namespace trace
+{
+    void setEnabled(bool enabled)
+    {
+        sEnabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    bool isEnabled()
+    {
+        return sEnabled.load(std::memory_order_relaxed);
+    }
+
+    void setThreadName(const char *name)
+    {
+        uint32_t tid = currentTid();
+        std::lock_guard<std::mutex> lock(sThreadNameMutex);
+        for (auto &item : sThreadNames)
+        {
+            if (item.first == tid)
+            {
+                item.second = name;
+                return;
+            }
+        }
+        sThreadNames.emplace_back(tid, name);
+    }
+
+    uint64_t nowUs()
+    {
+        // +1 so that a valid timestamp is never 0, which Scope uses as "disabled"
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - sEpoch).count() + 1;
+    }
+
+    void addEvent(const char *name, uint64_t startUs, uint64_t endUs)
+    {
+        uint64_t index = sHead.fetch_add(1, std::memory_order_relaxed);
+        TraceEvent &ev = sEvents[index & kMask];
+        ev.seq.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        ev.name = name;
+        ev.tid = currentTid();
+        ev.startUs = startUs;
+        ev.durUs = endUs - startUs;
+        ev.seq.store(index + 1, std::memory_order_release);
+    }
+
+    int flush(const char *path)
+    {
+        FILE *fp = fopen(path, "w");
+        if (!fp) return -1;
+
+        fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+        {
+            std::lock_guard<std::mutex> lock(sThreadNameMutex);
+            for (const auto &item : sThreadNames)
+            {
+                fprintf(fp, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"", item.first);
+                writeEscaped(fp, item.second.c_str());
+                fprintf(fp, "\"}},\n");
+            }
+        }
+
+        uint64_t head = sHead.load(std::memory_order_acquire);
+        uint64_t first = head > kCapacity ? head - kCapacity : 0;
+        int count = 0;
+        for (uint64_t index = first; index < head; index++)
+        {
+            TraceEvent &ev = sEvents[index & kMask];
+            if (ev.seq.load(std::memory_order_acquire) != index + 1) continue; // overwritten or in flight
+            const char *name = ev.name;
+            uint32_t tid = ev.tid;
+            uint64_t startUs = ev.startUs;
+            uint64_t durUs = ev.durUs;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (ev.seq.load(std::memory_order_relaxed) != index + 1) continue;
+
+            fprintf(fp, "%s{\"name\":\"", count > 0 ? ",\n" : "");
+            writeEscaped(fp, name);
+            fprintf(fp, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%llu,\"dur\":%llu}",
+                tid, (unsigned long long)startUs, (unsigned long long)durUs);
+            count++;
+        }
+        if (count == 0)
+        {
+            // keep the array valid when the metadata block ended with a comma
+            fprintf(fp, "{\"name\":\"empty\",\"ph\":\"i\",\"pid\":1,\"tid\":0,\"ts\":0}");
+        }
+        fprintf(fp, "\n]}\n");
+        fclose(fp);
+        return count;
+    }
+}
+
+#endif
@@ -0,0 +1,111 @@
+#include "MiniAreaScanApp.h"
+#include "cinder/Rand.h"
+#include "Cinder-VNM/include/MiniConfig.h"
+
+#include <chrono>
+
+namespace
+{
+    // The per-frame bundle construction sendTuioMessage() used before TuioEncoder.
+    size_t encodeWithOsc(const vector<TuioCursor> &cursors, int32_t frame)
+    {
+        osc::Bundle bundle;
+
+        osc::Message alive;
+        alive.setAddress("/tuio/2Dcur");
+        alive.append("alive");
+
+        osc::Message fseq;
+        fseq.setAddress("/tuio/2Dcur");
+        fseq.append("fseq");
+        fseq.append(frame);
+
+        for (const auto &cursor : cursors)
+        {
+            osc::Message set;
+            set.setAddress("/tuio/2Dcur");
+            set.append("set");
+            set.append(cursor.id);
+            set.append(cursor.x);
+            set.append(cursor.y);
+            set.append(cursor.vx);
+            set.append(cursor.vy);
+            set.append(cursor.accel);
+            bundle.append(set);
+
+            alive.append(cursor.id);
+        }
+
+        bundle.append(alive);
+        bundle.append(fseq);
+
+        // force serialization, which is what SenderBase::send() does
+        return bundle.getSharedBuffer()->size();
+    }
+
+    template <typename Fn>
+    double measureUs(int iterations, Fn fn)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < iterations; i++)
+        {
+            fn(i);
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration<double, std::micro>(end - start).count() / iterations;
+    }
+}
+
+void MiniAreaScanApp::benchmarkTuio()
+{
+    const int kIterations = 2000;
+    const int kBlobCounts[] = { 1, 10, 50, 200 };
+
+    TuioEncoder encoder(TUIO_MTU);
+    vector<TuioCursor> cursors;
+
+    CI_LOG_I("TUIO benchmark, " << kIterations << " frames each, MTU " << TUIO_MTU);
+    for (int blobCount : kBlobCounts)
+    {
+        cursors.resize(blobCount);
+        for (int i = 0; i < blobCount; i++)
+        {
+            cursors[i] = { i, randFloat(), randFloat(), randFloat(-0.01f, 0.01f), randFloat(-0.01f, 0.01f), 0.0f };
+        }
+
+        size_t oscBytes = 0;
+        double oscUs = measureUs(kIterations, [&](int frame) {
+            oscBytes = encodeWithOsc(cursors, frame);
+        });
+
+        size_t packets = 0;
+        double encoderUs = measureUs(kIterations, [&](int) {
+            packets = encoder.encode(cursors.data(), cursors.size());
+        });
+        size_t encoderBytes = 0;
+        for (size_t i = 0; i < packets; i++)
+        {
+            encoderBytes += encoder.getPacketSize(i);
+        }
+
+        CI_LOG_I(blobCount << " blobs: cinder::osc " << oscUs << " us (" << oscBytes << " bytes, 1 bundle), "
+            << "TuioEncoder " << encoderUs << " us (" << encoderBytes << " bytes, " << packets << " bundles)");
+
+        // delta mode on a mostly static scene, one in ten blobs moving per frame
+        TuioEncoder deltaEncoder(TUIO_MTU);
+        deltaEncoder.setDeltaMode(true, TUIO_DELTA_THRESHOLD, TUIO_REFRESH_FRAMES);
+        size_t deltaBytes = 0;
+        double deltaUs = measureUs(kIterations, [&](int frame) {
+            for (int i = frame % 10; i < blobCount; i += 10)
+            {
+                cursors[i].x = randFloat();
+            }
+            size_t count = deltaEncoder.encode(cursors.data(), cursors.size());
+            for (size_t i = 0; i < count; i++)
+            {
+                deltaBytes += deltaEncoder.getPacketSize(i);
+            }
+        });
+        CI_LOG_I(blobCount << " blobs: TuioEncoder delta " << deltaUs << " us (" << deltaBytes / kIterations << " bytes per frame)");
+    }
+}
@@ -0,0 +1,308 @@
+#include "TuioEncoder.h"
+
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+namespace
+{
+    const char kCursorAddress[] = "/tuio/2Dcur";
+    const char kBlobAddress[] = "/tuio/2Dblb";
+    const float kTwoPi = 6.28318530718f;
+
+    // OSC strings are null terminated and padded to a multiple of 4 bytes
+    inline size_t paddedSize(size_t len)
+    {
+        return (len + 4) & ~size_t(3);
+    }
+
+    // size prefix + address + ",sifffff" + "set" + 6 arguments
+    const size_t kCursorSetElementSize = 4 + paddedSize(sizeof(kCursorAddress) - 1) + paddedSize(8) + paddedSize(3) + 6 * 4;
+    // size prefix + address + ",sifffffffffff" + "set" + 12 arguments
+    const size_t kBlobSetElementSize = 4 + paddedSize(sizeof(kBlobAddress) - 1) + paddedSize(14) + paddedSize(3) + 12 * 4;
+    // size prefix + address + ",si" + "fseq" + 1 argument
+    const size_t kFseqElementSize = 4 + paddedSize(sizeof(kCursorAddress) - 1) + paddedSize(3) + paddedSize(4) + 4;
+    // "#bundle" + time tag
+    const size_t kBundleHeaderSize = paddedSize(7) + 8;
+
+    // size prefix + address + ",s" and one "i" per id + "alive" + ids
+    inline size_t aliveElementSize(size_t count)
+    {
+        return 4 + paddedSize(sizeof(kCursorAddress) - 1) + paddedSize(2 + count) + paddedSize(5) + count * 4;
+    }
+
+    inline bool exceeds(float a, float b, float threshold)
+    {
+        return fabsf(a - b) > threshold;
+    }
+}
+
+TuioEncoder::TuioEncoder(size_t mtu)
+{
+    setMtu(mtu);
+    mBuffer.resize(64 * 1024);
+    mPackets.reserve(16);
+}
+
+void TuioEncoder::setMtu(size_t mtu)
+{
+    mMtu = mtu;
+}
+
+void TuioEncoder::setDeltaMode(bool enabled, float threshold, int refreshInterval)
+{
+    if (enabled && !mDeltaMode)
+    {
+        // start with a full refresh
+        mSentStates.clear();
+        mFramesSinceRefresh = 0;
+    }
+    mDeltaMode = enabled;
+    mDeltaThreshold = threshold;
+    mRefreshInterval = std::max(refreshInterval, 1);
+}
+
+size_t TuioEncoder::getMaxCount() const
+{
+    size_t setElementSize = (mProfiles & PROFILE_2DBLB) ? kBlobSetElementSize : kCursorSetElementSize;
+    size_t fixedSize = kBundleHeaderSize + kFseqElementSize + setElementSize;
+    if (mMtu <= fixedSize + aliveElementSize(1)) return 1;
+
+    size_t maxCount = (mMtu - fixedSize) / 5;
+    while (maxCount > 1 && fixedSize + aliveElementSize(maxCount) > mMtu) maxCount--;
+    return maxCount;
+}
+
+size_t TuioEncoder::encode(const TuioCursor *cursors, size_t count)
+{
+    mPackets.clear();
+    mWritePos = 0;
+
+    // the alive list has to fit into every bundle
+    size_t maxCount = getMaxCount();
+    mTruncatedCount = count > maxCount ? count - maxCount : 0;
+    count -= mTruncatedCount;
+
+    updateSendMask(cursors, count);
+
+    if (mProfiles & PROFILE_2DCUR) encodeProfile(PROFILE_2DCUR, cursors, count);
+    if (mProfiles & PROFILE_2DBLB) encodeProfile(PROFILE_2DBLB, cursors, count);
+
+    return mPackets.size();
+}
+
+void TuioEncoder::updateSendMask(const TuioCursor *cursors, size_t count)
+{
+    mSendMask.assign(count, 1);
+    mSkippedCount = 0;
+    if (!mDeltaMode) return;
+
+    bool refresh = mFramesSinceRefresh == 0;
+    if (++mFramesSinceRefresh >= mRefreshInterval) mFramesSinceRefresh = 0;
+
+    // mSentStates only contains ids that are still alive after this frame
+    mNextSentStates.clear();
+    for (size_t i = 0; i < count; i++)
+    {
+        const TuioCursor &cursor = cursors[i];
+        auto it = std::lower_bound(mSentStates.begin(), mSentStates.end(), cursor.id,
+            [](const SentState &state, int32_t id) { return state.id < id; });
+        bool known = it != mSentStates.end() && it->id == cursor.id;
+
+        bool changed = refresh || !known
+            || exceeds(cursor.x, it->x, mDeltaThreshold)
+            || exceeds(cursor.y, it->y, mDeltaThreshold)
+            || exceeds(cursor.vx, it->vx, mDeltaThreshold)
+            || exceeds(cursor.vy, it->vy, mDeltaThreshold);
+        if (!changed && (mProfiles & PROFILE_2DBLB))
+        {
+            changed = exceeds(cursor.angle, it->angle, mDeltaThreshold * kTwoPi)
+                || exceeds(cursor.width, it->width, mDeltaThreshold)
+                || exceeds(cursor.height, it->height, mDeltaThreshold);
+        }
+
+        if (changed)
+        {
+            mNextSentStates.push_back({ cursor.id, cursor.x, cursor.y, cursor.vx, cursor.vy,
+                cursor.angle, cursor.width, cursor.height });
+        }
+        else
+        {
+            mNextSentStates.push_back(*it);
+            mSendMask[i] = 0;
+            mSkippedCount++;
+        }
+    }
+    std::sort(mNextSentStates.begin(), mNextSentStates.end(),
+        [](const SentState &a, const SentState &b) { return a.id < b.id; });
+    mSentStates.swap(mNextSentStates);
+}
+
+void TuioEncoder::encodeProfile(Profile profile, const TuioCursor *cursors, size_t count)
+{
+    const char *address = profile == PROFILE_2DBLB ? kBlobAddress : kCursorAddress;
+    size_t setElementSize = profile == PROFILE_2DBLB ? kBlobSetElementSize : kCursorSetElementSize;
+
+    size_t next = 0;
+    do
+    {
+        beginBundle();
+        writeAlive(address, cursors, count);
+        size_t setCount = 0;
+        while (next < count)
+        {
+            if (!mSendMask[next])
+            {
+                next++;
+                continue;
+            }
+            size_t bundleSize = mWritePos - mBundleStart;
+            // always take at least one set so that we make progress even with a tiny MTU
+            if (setCount > 0 && bundleSize + setElementSize + kFseqElementSize > mMtu) break;
+            if (profile == PROFILE_2DBLB) writeBlobSet(cursors[next++]);
+            else writeCursorSet(cursors[next++]);
+            setCount++;
+        }
+        writeFseq(address);
+        endBundle();
+    } while (next < count);
+}
+
+void TuioEncoder::beginBundle()
+{
+    mBundleStart = mWritePos;
+    writeString("#bundle", 7);
+    // OSC time tag "immediately"
+    writeInt32(0);
+    writeInt32(1);
+}
+
+void TuioEncoder::endBundle()
+{
+    mPackets.push_back({ mBundleStart, mWritePos - mBundleStart });
+}
+
+void TuioEncoder::writeAlive(const char *address, const TuioCursor *cursors, size_t count)
+{
+    size_t sizePos = beginElement();
+    writeString(address, strlen(address));
+
+    size_t tagLen = 2 + count;
+    size_t tagSize = paddedSize(tagLen);
+    ensureCapacity(tagSize);
+    uint8_t *tag = mBuffer.data() + mWritePos;
+    memset(tag, 0, tagSize);
+    tag[0] = ',';
+    tag[1] = 's';
+    memset(tag + 2, 'i', count);
+    mWritePos += tagSize;
+
+    writeString("alive", 5);
+    for (size_t i = 0; i < count; i++)
+    {
+        writeInt32(cursors[i].id);
+    }
+    endElement(sizePos);
+}
+
+void TuioEncoder::writeCursorSet(const TuioCursor &cursor)
+{
+    size_t sizePos = beginElement();
+    writeString(kCursorAddress, sizeof(kCursorAddress) - 1);
+    writeString(",sifffff", 8);
+    writeString("set", 3);
+    writeInt32(cursor.id);
+    writeFloat(cursor.x);
+    writeFloat(cursor.y);
+    writeFloat(cursor.vx);
+    writeFloat(cursor.vy);
+    writeFloat(cursor.accel);
+    endElement(sizePos);
+}
+
+void TuioEncoder::writeBlobSet(const TuioCursor &cursor)
+{
+    // set s x y a w h f X Y A m r
+    size_t sizePos = beginElement();
+    writeString(kBlobAddress, sizeof(kBlobAddress) - 1);
+    writeString(",sifffffffffff", 14);
+    writeString("set", 3);
+    writeInt32(cursor.id);
+    writeFloat(cursor.x);
+    writeFloat(cursor.y);
+    writeFloat(cursor.angle);
+    writeFloat(cursor.width);
+    writeFloat(cursor.height);
+    writeFloat(cursor.area);
+    writeFloat(cursor.vx);
+    writeFloat(cursor.vy);
+    writeFloat(cursor.rotationSpeed);
+    writeFloat(cursor.accel);
+    writeFloat(cursor.rotationAccel);
+    endElement(sizePos);
+}
+
+void TuioEncoder::writeFseq(const char *address)
+{
+    size_t sizePos = beginElement();
+    writeString(address, strlen(address));
+    writeString(",si", 3);
+    writeString("fseq", 4);
+    writeInt32(mFseq++);
+    endElement(sizePos);
+}
+
+void TuioEncoder::ensureCapacity(size_t extraBytes)
+{
+    size_t required = mWritePos + extraBytes;
+    if (required > mBuffer.size())
+    {
+        mBuffer.resize(std::max(required, mBuffer.size() * 2));
+    }
+}
+
+void TuioEncoder::writeInt32(int32_t v)
+{
+    ensureCapacity(4);
+    uint32_t u = (uint32_t)v;
+    uint8_t *p = mBuffer.data() + mWritePos;
+    p[0] = (uint8_t)(u >> 24);
+    p[1] = (uint8_t)(u >> 16);
+    p[2] = (uint8_t)(u >> 8);
+    p[3] = (uint8_t)(u);
+    mWritePos += 4;
+}
+
+void TuioEncoder::writeFloat(float v)
+{
+    int32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    writeInt32(bits);
+}
+
+void TuioEncoder::writeString(const char *str, size_t len)
+{
+    size_t size = paddedSize(len);
+    ensureCapacity(size);
+    uint8_t *p = mBuffer.data() + mWritePos;
+    memcpy(p, str, len);
+    memset(p + len, 0, size - len);
+    mWritePos += size;
+}
+
+size_t TuioEncoder::beginElement()
+{
+    size_t sizePos = mWritePos;
+    writeInt32(0); // patched in endElement()
+    return sizePos;
+}
+
+void TuioEncoder::endElement(size_t sizePos)
+{
+    uint32_t size = (uint32_t)(mWritePos - sizePos - 4);
+    uint8_t *p = mBuffer.data() + sizePos;
+    p[0] = (uint8_t)(size >> 24);
+    p[1] = (uint8_t)(size >> 16);
+    p[2] = (uint8_t)(size >> 8);
+    p[3] = (uint8_t)(size);
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+// TUIO 1.1 encoder that serializes OSC bundles straight into a preallocated
+// byte buffer, without any per-frame heap allocation once warmed up.
+//
+// A frame whose bundle would exceed the MTU is split into several bundles.
+// Every bundle carries the complete alive list (so clients never drop cursors
+// that happen to be in another bundle) and its own fseq, incremented per
+// bundle, because TUIO clients ignore bundles whose fseq does not advance.
+// Since the alive list can't be split, a frame is limited to as many
+// entities as fit into one alive message next to a set and the fseq, about
+// (MTU - 160) / 5 with the 2Dblb profile, 262 at the default MTU. Entities
+// beyond that limit are left out of the frame entirely.
+//
+// In delta mode "set" messages are only emitted for new entities and for
+// entities whose state changed beyond a threshold, with a periodic full
+// refresh so late-joining clients and lost packets recover.
+
+struct TuioCursor
+{
+    int32_t id;
+    float x, y;     // normalized position
+    float vx, vy;   // velocity, normalized like x and y
+    float accel;    // motion acceleration
+
+    // only used by the 2Dblb profile
+    float angle;    // radians
+    float width, height, area;
+    float rotationSpeed, rotationAccel;
+};
+
+class TuioEncoder
+{
+public:
+    enum
+    {
+        DEFAULT_MTU = 1472, // 1500 bytes ethernet MTU - IPv4 header - UDP header
+    };
+
+    enum Profile
+    {
+        PROFILE_2DCUR = 1 << 0,
+        PROFILE_2DBLB = 1 << 1,
+    };
+
+    TuioEncoder(size_t mtu = DEFAULT_MTU);
+
+    void setMtu(size_t mtu);
+    size_t getMtu() const { return mMtu; }
+
+    // Bitmask of Profile values, each enabled profile gets its own bundles.
+    void setProfiles(int profiles) { mProfiles = profiles; }
+    int getProfiles() const { return mProfiles; }
+
+    // threshold is in normalized units (angle: fraction of a full turn),
+    // refreshInterval is the number of frames between full refreshes.
+    void setDeltaMode(bool enabled, float threshold, int refreshInterval);
+
+    // Encodes one frame into one or more bundles, returns the bundle count.
+    // The packets stay valid until the next call.
+    size_t encode(const TuioCursor *cursors, size_t count);
+
+    size_t getPacketCount() const { return mPackets.size(); }
+    const uint8_t *getPacketData(size_t i) const { return mBuffer.data() + mPackets[i].offset; }
+    size_t getPacketSize(size_t i) const { return mPackets[i].size; }
+
+    int32_t getFrameSequence() const { return mFseq; }
+
+    // Number of "set" messages skipped by delta mode in the last frame.
+    size_t getSkippedCount() const { return mSkippedCount; }
+
+    // Most entities one frame can carry at the current MTU and profiles.
+    size_t getMaxCount() const;
+
+    // Number of entities left out of the last frame because of getMaxCount().
+    size_t getTruncatedCount() const { return mTruncatedCount; }
+
+private:
+    struct Packet
+    {
+        size_t offset;
+        size_t size;
+    };
+
+    struct SentState
+    {
+        int32_t id;
+        float x, y, vx, vy;
+        float angle, width, height;
+    };
+
+    void updateSendMask(const TuioCursor *cursors, size_t count);
+    void encodeProfile(Profile profile, const TuioCursor *cursors, size_t count);
+
+    void beginBundle();
+    void endBundle();
+    void writeAlive(const char *address, const TuioCursor *cursors, size_t count);
+    void writeCursorSet(const TuioCursor &cursor);
+    void writeBlobSet(const TuioCursor &cursor);
+    void writeFseq(const char *address);
+
+    void ensureCapacity(size_t extraBytes);
+    void writeInt32(int32_t v);
+    void writeFloat(float v);
+    void writeString(const char *str, size_t len);
+    size_t beginElement();
+    void endElement(size_t sizePos);
+
+    size_t mMtu;
+    int mProfiles = PROFILE_2DCUR;
+    int32_t mFseq = 0;
+
+    bool mDeltaMode = false;
+    float mDeltaThreshold = 0;
+    int mRefreshInterval = 1;
+    int mFramesSinceRefresh = 0;
+    size_t mSkippedCount = 0;
+    size_t mTruncatedCount = 0;
+    std::vector<uint8_t> mSendMask;         // per cursor of the current frame
+    std::vector<SentState> mSentStates;     // sorted by id
+    std::vector<SentState> mNextSentStates;
+
+    std::vector<uint8_t> mBuffer;
+    size_t mWritePos = 0;
+    size_t mBundleStart = 0;
+    std::vector<Packet> mPackets;
+};
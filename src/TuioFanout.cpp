@@ -0,0 +1,252 @@
+#include "TuioFanout.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <algorithm>
+
+namespace
+{
+    std::string trim(const std::string &str)
+    {
+        size_t first = str.find_first_not_of(" \t\r\n");
+        if (first == std::string::npos) return "";
+        size_t last = str.find_last_not_of(" \t\r\n");
+        return str.substr(first, last - first + 1);
+    }
+
+    bool parseFloat(const std::string &str, float *value)
+    {
+        char *end = nullptr;
+        *value = strtof(str.c_str(), &end);
+        return !str.empty() && end == str.c_str() + str.size();
+    }
+}
+
+bool TuioFanout::setDestinations(const std::string &spec, std::string *error)
+{
+    std::vector<std::unique_ptr<Group>> groups;
+    std::vector<Destination> destinations;
+
+    size_t start = 0;
+    while (start <= spec.size())
+    {
+        size_t end = spec.find(';', start);
+        if (end == std::string::npos) end = spec.size();
+        std::string item = trim(spec.substr(start, end - start));
+        start = end + 1;
+        if (item.empty()) continue;
+
+        bool useDefaultMapping = true;
+        TuioMapping mapping = mDefaultMapping;
+        size_t at = item.find('@');
+        if (at != std::string::npos)
+        {
+            std::string rect = item.substr(at + 1);
+            item = trim(item.substr(0, at));
+            float v[4];
+            size_t pos = 0;
+            for (int i = 0; i < 4; i++)
+            {
+                size_t comma = i < 3 ? rect.find(',', pos) : rect.size();
+                if (comma == std::string::npos || !parseFloat(trim(rect.substr(pos, comma - pos)), &v[i]))
+                {
+                    if (error) *error = "invalid mapping in \"" + item + "\"";
+                    return false;
+                }
+                pos = comma + 1;
+            }
+            mapping = { v[0], v[1], v[2], v[3] };
+            useDefaultMapping = false;
+        }
+
+        float maxHz = 0;
+        size_t slash = item.find('/');
+        if (slash != std::string::npos)
+        {
+            if (!parseFloat(trim(item.substr(slash + 1)), &maxHz) || maxHz < 0)
+            {
+                if (error) *error = "invalid rate in \"" + item + "\"";
+                return false;
+            }
+            item = trim(item.substr(0, slash));
+        }
+
+        size_t colon = item.rfind(':');
+        int port = colon == std::string::npos ? 0 : atoi(item.c_str() + colon + 1);
+        if (port <= 0 || port > 65535)
+        {
+            if (error) *error = "invalid port in \"" + item + "\"";
+            return false;
+        }
+        asio::error_code ec;
+        asio::ip::address address = asio::ip::address::from_string(item.substr(0, colon), ec);
+        if (ec || !address.is_v4())
+        {
+            if (error) *error = "invalid IPv4 address in \"" + item + "\"";
+            return false;
+        }
+
+        size_t group = 0;
+        for (; group < groups.size(); group++)
+        {
+            const Group &g = *groups[group];
+            if (g.useDefaultMapping == useDefaultMapping && g.maxHz == maxHz
+                && (useDefaultMapping || g.mapping == mapping)) break;
+        }
+        if (group == groups.size())
+        {
+            std::unique_ptr<Group> g(new Group());
+            g->useDefaultMapping = useDefaultMapping;
+            g->mapping = mapping;
+            g->maxHz = maxHz;
+            g->nextSendTime = 0;
+            groups.push_back(std::move(g));
+        }
+        destinations.push_back({ asio::ip::udp::endpoint(address, (unsigned short)port), group });
+    }
+
+    mGroups.swap(groups);
+    mDestinations.swap(destinations);
+    mSocketOptionsDirty = true;
+    return true;
+}
+
+void TuioFanout::setMulticastTtl(int ttl)
+{
+    if (ttl == mMulticastTtl) return;
+    mMulticastTtl = ttl;
+    mSocketOptionsDirty = true;
+}
+
+void TuioFanout::setEncoderOptions(size_t mtu, int profiles, bool deltaMode, float deltaThreshold, int refreshInterval)
+{
+    for (auto &group : mGroups)
+    {
+        group->encoder.setMtu(mtu);
+        group->encoder.setProfiles(profiles);
+        group->encoder.setDeltaMode(deltaMode, deltaThreshold, refreshInterval);
+    }
+}
+
+asio::error_code TuioFanout::send(asio::ip::udp::socket &socket, const TuioCursor *cursors, size_t count, double nowSeconds)
+{
+    if (mSocketOptionsDirty)
+    {
+        bool multicast = false;
+        for (const auto &dest : mDestinations)
+        {
+            multicast |= dest.endpoint.address().is_multicast();
+        }
+        if (multicast)
+        {
+            asio::error_code ec;
+            socket.set_option(asio::ip::multicast::hops(mMulticastTtl), ec);
+            socket.set_option(asio::ip::multicast::enable_loopback(true), ec);
+        }
+        mSocketOptionsDirty = false;
+    }
+
+    mGroupDue.assign(mGroups.size(), 0);
+    for (size_t g = 0; g < mGroups.size(); g++)
+    {
+        Group &group = *mGroups[g];
+        if (group.maxHz > 0)
+        {
+            double interval = 1.0 / group.maxHz;
+            // a quarter interval of slack so that frame jitter does not halve the rate
+            if (nowSeconds + interval * 0.25 < group.nextSendTime) continue;
+            group.nextSendTime += interval;
+            if (group.nextSendTime <= nowSeconds) group.nextSendTime = nowSeconds + interval;
+        }
+
+        const TuioMapping &m = group.useDefaultMapping ? mDefaultMapping : group.mapping;
+        float sx = m.x2 - m.x1;
+        float sy = m.y2 - m.y1;
+        group.mappedCursors.assign(cursors, cursors + count);
+        for (auto &cursor : group.mappedCursors)
+        {
+            cursor.x = m.x1 + cursor.x * sx;
+            cursor.y = m.y1 + cursor.y * sy;
+            cursor.vx *= sx;
+            cursor.vy *= sy;
+            cursor.accel *= sx;
+            cursor.width *= sx;
+            cursor.height *= sy;
+            cursor.area *= sx * sy;
+        }
+        group.encoder.encode(group.mappedCursors.data(), group.mappedCursors.size());
+        mGroupDue[g] = 1;
+    }
+
+    return sendPackets(socket);
+}
+
+asio::error_code TuioFanout::sendPackets(asio::ip::udp::socket &socket)
+{
+#if defined(__linux__)
+    size_t total = 0;
+    for (const auto &dest : mDestinations)
+    {
+        if (mGroupDue[dest.group]) total += mGroups[dest.group]->encoder.getPacketCount();
+    }
+    if (total == 0) return asio::error_code();
+
+    mMessages.resize(total);
+    mIovecs.resize(total);
+    size_t n = 0;
+    for (auto &dest : mDestinations)
+    {
+        if (!mGroupDue[dest.group]) continue;
+        const TuioEncoder &encoder = mGroups[dest.group]->encoder;
+        for (size_t i = 0; i < encoder.getPacketCount(); i++, n++)
+        {
+            mIovecs[n].iov_base = (void *)encoder.getPacketData(i);
+            mIovecs[n].iov_len = encoder.getPacketSize(i);
+            mmsghdr &msg = mMessages[n];
+            msg = mmsghdr();
+            msg.msg_hdr.msg_name = dest.endpoint.data();
+            msg.msg_hdr.msg_namelen = (socklen_t)dest.endpoint.size();
+            msg.msg_hdr.msg_iov = &mIovecs[n];
+            msg.msg_hdr.msg_iovlen = 1;
+        }
+    }
+
+    // one unreachable destination must not cost the others their frame:
+    // skip the message that failed, keep the first error for the caller
+    int fd = socket.native_handle();
+    asio::error_code firstError;
+    size_t sent = 0;
+    while (sent < total)
+    {
+        int ret = sendmmsg(fd, mMessages.data() + sent, (unsigned int)(total - sent), 0);
+        if (ret < 0)
+        {
+            if (errno == EINTR) continue;
+            if (!firstError) firstError = asio::error_code(errno, asio::system_category());
+            sent++;
+            continue;
+        }
+        sent += ret;
+    }
+    return firstError;
+#else
+    asio::error_code firstError;
+    for (const auto &dest : mDestinations)
+    {
+        if (!mGroupDue[dest.group]) continue;
+        const TuioEncoder &encoder = mGroups[dest.group]->encoder;
+        for (size_t i = 0; i < encoder.getPacketCount(); i++)
+        {
+            // e.g. WSAECONNRESET from an earlier ICMP port unreachable, skip to the next destination
+            asio::error_code ec;
+            socket.send_to(asio::buffer(encoder.getPacketData(i), encoder.getPacketSize(i)), dest.endpoint, 0, ec);
+            if (ec)
+            {
+                if (!firstError) firstError = ec;
+                break;
+            }
+        }
+    }
+    return firstError;
+#endif
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "asio/asio.hpp"
+#include "TuioEncoder.h"
+
+#if defined(__linux__)
+#include <sys/socket.h>
+#include <sys/uio.h>
+#endif
+
+// Sends the same TUIO stream to several UDP destinations (unicast or IPv4
+// multicast), each with its own rate cap and output mapping.
+//
+// Destinations that share mapping and rate cap form a group, and every group
+// is encoded once per frame. All packets of a frame go out in one batched
+// sendmmsg() call on Linux.
+
+struct TuioMapping
+{
+    float x1, y1, x2, y2;   // output rectangle for the normalized input ROI
+
+    bool operator==(const TuioMapping &other) const
+    {
+        return x1 == other.x1 && y1 == other.y1 && x2 == other.x2 && y2 == other.y2;
+    }
+};
+
+class TuioFanout
+{
+public:
+    // Destinations are separated by ';', each being "host:port[/maxHz][@x1,y1,x2,y2]",
+    // e.g. "127.0.0.1:3333; 239.1.1.1:3334/30; 10.0.0.7:3333@0,0,0.5,1".
+    // Without a mapping the default mapping is used, without maxHz every frame is sent.
+    // On a parse error the current destinations are kept and false is returned.
+    bool setDestinations(const std::string &spec, std::string *error = nullptr);
+    size_t getDestinationCount() const { return mDestinations.size(); }
+
+    void setDefaultMapping(const TuioMapping &mapping) { mDefaultMapping = mapping; }
+    void setMulticastTtl(int ttl);
+
+    // Applied to the encoder of every group.
+    void setEncoderOptions(size_t mtu, int profiles, bool deltaMode, float deltaThreshold, int refreshInterval);
+
+    // cursors are normalized to the input ROI, positions, velocities and sizes get mapped per group.
+    // Stops at the first failing packet and returns its error, the rest of the frame is not sent.
+    asio::error_code send(asio::ip::udp::socket &socket, const TuioCursor *cursors, size_t count, double nowSeconds);
+
+private:
+    struct Group
+    {
+        bool useDefaultMapping;
+        TuioMapping mapping;
+        float maxHz;
+        double nextSendTime;
+        TuioEncoder encoder;
+        std::vector<TuioCursor> mappedCursors;
+    };
+
+    struct Destination
+    {
+        asio::ip::udp::endpoint endpoint;
+        size_t group;
+    };
+
+    asio::error_code sendPackets(asio::ip::udp::socket &socket);
+
+    std::vector<std::unique_ptr<Group>> mGroups;
+    std::vector<Destination> mDestinations;
+    TuioMapping mDefaultMapping = { 0, 0, 1, 1 };
+
+    int mMulticastTtl = 1;
+    bool mSocketOptionsDirty = true;
+
+    // per frame scratch, reused across frames
+    std::vector<uint8_t> mGroupDue;
+#if defined(__linux__)
+    // sendmmsg() batch
+    std::vector<mmsghdr> mMessages;
+    std::vector<iovec> mIovecs;
+#endif
+};
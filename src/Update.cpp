@@ -6,51 +6,273 @@
 
 #include "../LidarDevice/RpLidarDevice.h"
 #include "../LidarDevice/YdLidarDevice.h"
+#include "../LidarDevice/ReplayLidarDevice.h"
+#include "Trace.h"
+#include "AllocCounter.h"
+#include "AsyncLog.h"
+
+#include <chrono>
 
 void MiniAreaScanApp::setup()
 {
     const auto& args = getCommandLineArgs();
     readConfig();
     log::makeLogger<log::LoggerFile>();
+    // the stage and SDK threads log through asynclog, only its writer thread reaches the file
+    asynclog::setSink([](asynclog::Level level, const char *file, int line, const char *text, uint32_t suppressed) {
+        const log::Level levels[] = { log::LEVEL_INFO, log::LEVEL_WARNING, log::LEVEL_ERROR };
+        log::Entry entry(levels[level], log::Location("", file, line));
+        entry << text;
+        if (suppressed > 0) entry << " (" << suppressed << " suppressed)";
+    });
     console() << "EXE built on " << __DATE__ << endl;
 
-    if (_RP_LIDAR)
-    {
-        mDevice = make_unique<RpLidarDevice>();
-    }
-    else
-    {
-        mDevice = make_unique<YdLidarDevice>();
-    }
-    mDevice->setup(LIDAR_PORT);
+#if defined(MINIAREASCAN_TRACE)
+    setupTrace();
+#endif
+#if defined(MINIAREASCAN_ALLOC_COUNTER)
+    mAllocCheck = std::find(args.begin(), args.end(), "--alloc-check") != args.end();
+#endif
+    mRecordScans = std::find(args.begin(), args.end(), "--record-scans") != args.end();
+
+    setupDevices();
 
     {
         mParams = createConfigUI({ 400, 600 });
 
         mParams->addParam("FPS", &mFps, true);
+        mParams->addParam("Detection ms", &mDetectionLatencyMs, true);
+        mParams->addParam("Detection busy ms", &mDetectionBusyMs, true);
+        mParams->addParam("Output ms", &mOutputLatencyMs, true);
+        mParams->addParam("Output max ms", &mOutputMaxLatencyMs, true);
+        mParams->addParam("Dropped frames", &mDroppedFrames, true);
+        mParams->addParam("Packet jitter us", &mPacketJitterUs, true);
+        mParams->addParam("Packet max us", &mPacketMaxUs, true);
+        mParams->addParam("Log suppressed", &mLogSuppressed, true);
+        mParams->addParam("Log dropped", &mLogDropped, true);
         mParams->addButton("Reset In/Out", [] {
             INPUT_X1 = INPUT_Y1 = OUTPUT_X1 = OUTPUT_Y1 = 0;
             INPUT_X2 = INPUT_Y2 = OUTPUT_X2 = OUTPUT_Y2 = 1;
         });
 
         mParams->addButton("ReConnect", [&] {
-            mDevice->setup(LIDAR_PORT);
+            mFusion.reconnect();
+        });
+
+        mParams->addButton("Register lidars", [&] {
+            requestRegistration();
         });
     }
 
     mOscSender = std::make_unique<osc::SenderUdp>(10000, _ADDRESS, _TUIO_PORT);
     mOscSender->bind();
 
+    if (std::find(args.begin(), args.end(), "--bench-tuio") != args.end())
+    {
+        benchmarkTuio();
+    }
+
+    if (std::find(args.begin(), args.end(), "--check-bit-raster") != args.end())
+    {
+        checkBitRaster();
+    }
+
+    if (std::find(args.begin(), args.end(), "--register") != args.end())
+    {
+        requestRegistration();
+    }
+
     getWindow()->setSize(APP_WIDTH, APP_HEIGHT);
 
     mLogo = am::texture2d("logo.png");
     mShader = am::glslProg("texture");
+
+    startStages();
+}
+
+void MiniAreaScanApp::cleanup()
+{
+    stopStages();
+    mFusion.stop();
+    asynclog::stop();
+}
+
+
+void MiniAreaScanApp::setupDevices()
+{
+    // LIDAR_DEVICES: "type:port@x,y,angle; ..." with type rp, yd or file (a replay file), pose in mm and degree
+    // e.g. "rp:\\.\com4@0,0,0; rp:\\.\com5@3000,0,180"
+    string spec = LIDAR_DEVICES;
+    if (spec.empty())
+    {
+        spec = string(_RP_LIDAR ? "rp:" : "yd:") + LIDAR_PORT;
+    }
+#if defined(MINIAREASCAN_ALLOC_COUNTER)
+    // a checked-in recording, so that the check runs without hardware
+    if (mAllocCheck) spec = "file:" + getAssetPath("alloc-check-scans.txt").string();
+#endif
+
+    mFusion.clear();
+    mDeviceSpecs.clear();
+    for (auto item : split(spec, ';'))
+    {
+        item.erase(0, item.find_first_not_of(" \t"));
+        item.erase(item.find_last_not_of(" \t") + 1);
+        if (item.empty()) continue;
+
+        LidarPose pose = { 0, 0, 0 };
+        size_t at = item.rfind('@');
+        if (at != string::npos)
+        {
+            auto values = split(item.substr(at + 1), ',');
+            if (values.size() == 3)
+            {
+                pose.x = fromString<float>(values[0]);
+                pose.y = fromString<float>(values[1]);
+                pose.angle = fromString<float>(values[2]);
+            }
+            else
+            {
+                CI_LOG_E("Invalid pose in LIDAR_DEVICES: " << item);
+            }
+            item = item.substr(0, at);
+        }
+
+        unique_ptr<LidarDevice> device;
+        size_t colon = item.find(':');
+        string type = item.substr(0, colon);
+        if (colon != string::npos && type == "rp") device = make_unique<RpLidarDevice>();
+        else if (colon != string::npos && type == "yd") device = make_unique<YdLidarDevice>();
+        else if (colon != string::npos && type == "file") device = make_unique<ReplayLidarDevice>();
+        else
+        {
+            CI_LOG_E("Unknown lidar type in LIDAR_DEVICES: " << item);
+            continue;
+        }
+        string port = item.substr(colon + 1);
+        device->setup(port);
+        mFusion.addDevice(std::move(device), port, pose);
+        mDeviceSpecs.push_back(item);
+    }
+    mFusion.start();
+}
+
+void MiniAreaScanApp::requestRegistration()
+{
+    if (mFusion.getDeviceCount() < 2)
+    {
+        CI_LOG_E("Registration needs at least two lidars in LIDAR_DEVICES");
+        return;
+    }
+
+    ScanRegistration::Option option;
+    option.maxDistance = REGISTRATION_MAX_DIST_MM;
+    mRegistration.request(mFusion, option);
+    mLastRegistrationTime = getElapsedSeconds();
+}
+
+void MiniAreaScanApp::updateRegistration()
+{
+    if (REGISTRATION_INTERVAL_S > 0 && !mRegistration.isBusy()
+        && getElapsedSeconds() - mLastRegistrationTime > REGISTRATION_INTERVAL_S)
+    {
+        requestRegistration();
+    }
+
+    ScanRegistration::Result result;
+    if (!mRegistration.poll(result)) return;
+
+    // poses are applied here on the main thread, tracking never waits for the ICP
+    string spec;
+    for (size_t d = 0; d < result.poses.size() && d < mDeviceSpecs.size(); d++)
+    {
+        const auto &pose = result.poses[d];
+        if (result.converged[d])
+        {
+            mFusion.setPose(d, pose);
+        }
+        else
+        {
+            CI_LOG_E("Registration of " << mDeviceSpecs[d] << " did not converge, pose kept");
+        }
+        if (!spec.empty()) spec += "; ";
+        spec += mDeviceSpecs[d] + "@" + toString(pose.x) + "," + toString(pose.y) + "," + toString(pose.angle);
+        CI_LOG_I("Registered " << mDeviceSpecs[d] << ": " << pose.x << "," << pose.y << "," << pose.angle
+            << " rms " << result.rms[d] << " mm");
+    }
+    LIDAR_DEVICES = spec;
+}
+
+namespace
+{
+    // "x,y x,y x,y; x,y ..." in millimeter
+    vector<vector<cv::Point2f>> parsePolygons(const string &spec)
+    {
+        vector<vector<cv::Point2f>> polygons;
+        for (const auto &item : split(spec, ';'))
+        {
+            vector<cv::Point2f> polygon;
+            for (const auto &pair : split(item, ' '))
+            {
+                auto values = split(pair, ',');
+                if (values.size() != 2) continue;
+                polygon.emplace_back(fromString<float>(values[0]), fromString<float>(values[1]));
+            }
+            if (polygon.size() >= 3) polygons.push_back(polygon);
+            else if (!polygon.empty()) CI_LOG_E("Polygon needs at least 3 points: " << item);
+        }
+        return polygons;
+    }
 }
 
+void MiniAreaScanApp::updateAreaMask()
+{
+    AreaMask area = mAreaMask;
+    string spec = AREA_INCLUDE + "|" + AREA_EXCLUDE + "|" + BLIND_SECTORS;
+    if (spec != mAreaSpec)
+    {
+        mAreaSpec = spec;
+        area.include = parsePolygons(AREA_INCLUDE);
+        area.exclude = parsePolygons(AREA_EXCLUDE);
+        // "from,to; from,to" in degree, in each device's own angles
+        area.sectors.clear();
+        for (const auto &item : split(BLIND_SECTORS, ';'))
+        {
+            auto values = split(item, ',');
+            if (values.size() == 2) area.sectors.emplace_back(fromString<float>(values[0]), fromString<float>(values[1]));
+        }
+    }
+
+    area.roi.clear();
+    if (ROI_CULLING)
+    {
+        const Point2f corners[] = {
+            { mInputRoi.x1, mInputRoi.y1 }, { mInputRoi.x2, mInputRoi.y1 },
+            { mInputRoi.x2, mInputRoi.y2 }, { mInputRoi.x1, mInputRoi.y2 },
+        };
+        for (const auto &corner : corners)
+        {
+            area.roi.push_back(ScanPipeline::toWorld(corner, APP_WIDTH, APP_HEIGHT, mPipelineOption));
+        }
+    }
+
+    if (area != mAreaMask)
+    {
+        mAreaMask = area;
+        mFusion.setArea(area);
+    }
+}
 
 void MiniAreaScanApp::update()
 {
-    _STATUS = mDevice->status;
+#if defined(MINIAREASCAN_TRACE)
+    updateTrace();
+#endif
+    TRACE_SCOPE("MiniAreaScanApp::update");
+
+    _STATUS = mFusion.getStatus();
+
+    updateRegistration();
 
     mFps = getAverageFps();
 
@@ -67,34 +289,63 @@ void MiniAreaScanApp::update()
         OUTPUT_Y2 * APP_HEIGHT
     );
 
-    mDevice->update();
-    auto centerPt = getWindowCenter();
-    mFrontMat.setTo(cv::Scalar(0));
-    mDiffMat.setTo(cv::Scalar(0));
-    int scanCount = mDevice->scanData.size();
-    vector<cv::Point> points;
-    for (const auto& scanPoint : mDevice->scanData)
-    {
-        if (!scanPoint.valid) continue;
-        float distPixel = scanPoint.dist * MM_TO_PIXEL;
-        float rad = (float)((scanPoint.angle - BASE_ANGLE)*3.1415 / 180.0);
-        int x = sin(rad)*(distPixel)+centerPt.x;
-        int y = centerPt.y - cos(rad)*(distPixel);
-        points.emplace_back(cv::Point( x, y ));
-    }
+    mPipelineOption.mmToPixel = MM_TO_PIXEL;
+    mPipelineOption.baseAngle = BASE_ANGLE;
+    updateAreaMask();
 
-    for (auto& pt : points)
-    {
-        cv::circle(mDiffMat, pt, DOT_RADIUS, cv::Scalar(255), -1);
-        cv::circle(mFrontMat, pt, 3, cv::Scalar(255), -1);
-    }
+    ScanFilter::Option filterOption;
+    filterOption.minQuality = FILTER_MIN_QUALITY;
+    filterOption.isolationDistance = FILTER_ISOLATION_MM;
+    filterOption.window = FILTER_NEIGHBOURS + 1;
+    filterOption.minNeighbours = FILTER_NEIGHBOURS;
+    filterOption.edgeJump = FILTER_EDGE_JUMP_MM;
+    mFusion.setFilterOption(filterOption);
+
+    mFusionOption.cellSize = FUSION_CELL_MM;
+    mFusionOption.maxSkewMs = FUSION_MAX_SKEW_MS;
+
+    mPipelineOption.dotRadius = DOT_RADIUS;
+    mPipelineOption.finder.minArea = MIN_AREA;
+    mPipelineOption.clusterDistance = CLUSTER_DISTANCE_MM;
+    mPipelineOption.bitRaster = BIT_RASTER;
+    mPipelineOption.accumulateScans = ACCUMULATE_SCANS;
+    mPipelineOption.gateDistance = ACCUMULATE_GATE_MM;
+    mPipelineOption.coarseToFine = COARSE_TO_FINE;
+    mPipelineOption.redrawTolerance = REDRAW_TOLERANCE_PX;
+    mPipelineOption.finder.handOnlyMode = HAND_ONLY_MODE;
+    mPipelineOption.finder.handDistance = HAND_DISTANCE_MM * MM_TO_PIXEL;
+
+    // only have BlobFinder build the blob geometry that something reads
+    int outputs = 0;
+    if (TUIO_2DBLB || SHM_ENABLED) outputs |= BlobFinder::OUTPUT_SHAPE;
+    if (DRAW_BLOB_OUTLINES) outputs |= BlobFinder::OUTPUT_POLYGON;
+    mPipelineOption.finder.outputs = outputs;
+    updateStages();
+    recordScans();
+#if defined(MINIAREASCAN_ALLOC_COUNTER)
+    updateAllocCheck();
+#endif
+
+    // only the newest finished frame is shown, older ones go back to the stages
+    bool hasFrame = false;
+    while (mDisplayQueue.tryPop(mDisplayFrame)) hasFrame = true;
+    if (!hasFrame) return;
     updateDepthRelated();
 }
 
 
 void MiniAreaScanApp::updateDepthRelated()
 {
-    updateTexture(mFrontTexture, mFrontSurface);
+    // frames circulate between the stages, so the surfaces follow the current one
+    cv::Mat1b &frontMat = mDisplayFrame.frontMat;
+    cv::Mat1b &diffMat = mDisplayFrame.diffMat;
+    mFrontSurface = Channel(frontMat.cols, frontMat.rows, frontMat.step, 1, frontMat.ptr());
+    mDiffSurface = Channel(diffMat.cols, diffMat.rows, diffMat.step, 1, diffMat.ptr());
+
+    {
+        TRACE_SCOPE("upload front texture");
+        updateTexture(mFrontTexture, mFrontSurface);
+    }
 
     if (mMMtoPixel != MM_TO_PIXEL)
     {
@@ -133,18 +384,217 @@ void MiniAreaScanApp::updateDepthRelated()
                 // TODO: optimize
                 if (!CIRCLE_MASK_ENABLED || (cx - x) * (cx - x) + (cy - y) * (cy - y) < radius_sq)
                 {
-                    mDiffMat(yy, xx) = 255;
+                    mPipeline.diffMat(yy, xx) = 255;
                 }
             }
         }
     }
 #endif
 
-    updateTexture(mDiffTexture, mDiffSurface);
+    {
+        TRACE_SCOPE("upload diff texture");
+        updateTexture(mDiffTexture, mDiffSurface);
+    }
+}
+
+namespace
+{
+    // "0,2-3" to a cpu mask, empty for all cpus
+    uint64_t parseCpuList(const string &spec)
+    {
+        uint64_t mask = 0;
+        for (const auto &item : split(spec, ','))
+        {
+            auto range = split(item, '-');
+            if (range.empty() || range.size() > 2) continue;
+            int first = fromString<int>(range[0]);
+            int last = range.size() == 2 ? fromString<int>(range[1]) : first;
+            for (int cpu = std::max(first, 0); cpu <= last && cpu < 64; cpu++) mask |= 1ull << cpu;
+        }
+        return mask;
+    }
+}
+
+void MiniAreaScanApp::startStages()
+{
+    mOutputQueue.open();
+    mDisplayQueue.open();
+    mDetectionStage.start("detection", [this] { runDetection(); });
+    mOutputStage.start("output", [this] { runOutput(); });
+}
+
+void MiniAreaScanApp::stopStages()
+{
+    // a stage waiting on a queue only returns once the queue is closed
+    mOutputQueue.close();
+    mDisplayQueue.close();
+    mOutputStage.stop();
+    mDetectionStage.stop();
+}
+
+void MiniAreaScanApp::updateStages()
+{
+    {
+        std::lock_guard<std::mutex> lock(mStageOptionMutex);
+        mPendingDetectionOption.fusion = mFusionOption;
+        mPendingDetectionOption.pipeline = mPipelineOption;
+        mPendingDetectionOption.frameWidth = APP_WIDTH;
+        mPendingDetectionOption.frameHeight = APP_HEIGHT;
+
+        OutputOption &output = mPendingOutputOption;
+        output.tuioDestinations = TUIO_DESTINATIONS.empty() ? _ADDRESS + ":" + toString(_TUIO_PORT) : TUIO_DESTINATIONS;
+        output.inputRoi = mInputRoi;
+        output.inputX1 = INPUT_X1;
+        output.inputY1 = INPUT_Y1;
+        output.inputX2 = INPUT_X2;
+        output.inputY2 = INPUT_Y2;
+        output.mapping = { OUTPUT_X1, OUTPUT_Y1, OUTPUT_X2, OUTPUT_Y2 };
+        output.multicastTtl = TUIO_MULTICAST_TTL;
+        output.mtu = TUIO_MTU;
+        output.profiles = (TUIO_2DCUR ? TuioEncoder::PROFILE_2DCUR : 0) | (TUIO_2DBLB ? TuioEncoder::PROFILE_2DBLB : 0);
+        output.deltaMode = TUIO_DELTA;
+        output.deltaThreshold = TUIO_DELTA_THRESHOLD;
+        output.refreshFrames = TUIO_REFRESH_FRAMES;
+        output.shmName = SHM_ENABLED ? SHM_NAME : "";
+        output.frameWidth = APP_WIDTH;
+        output.frameHeight = APP_HEIGHT;
+    }
+
+    asynclog::setRateLimit(LOG_RATE_BURST, LOG_RATE_PERIOD_MS);
+
+    mOutputQueue.setOverflow(OUTPUT_QUEUE_BLOCK ? FrameQueue<Frame>::OVERFLOW_BLOCK : FrameQueue<Frame>::OVERFLOW_DROP_OLDEST);
+    mDisplayQueue.setOverflow(DISPLAY_QUEUE_BLOCK ? FrameQueue<Frame>::OVERFLOW_BLOCK : FrameQueue<Frame>::OVERFLOW_DROP_OLDEST);
+
+    string cpuSpec = ACQUISITION_CPUS + "|" + DETECTION_CPUS + "|" + OUTPUT_CPUS;
+    if (cpuSpec != mCpuSpec)
+    {
+        mCpuSpec = cpuSpec;
+        mFusion.setAffinity(parseCpuList(ACQUISITION_CPUS));
+        mDetectionStage.setAffinity(parseCpuList(DETECTION_CPUS));
+        mOutputStage.setAffinity(parseCpuList(OUTPUT_CPUS));
+    }
+
+    string lidarThreadSpec = toString(LIDAR_RT_PRIORITY) + "|" + toString(LIDAR_RT_ROUND_ROBIN) + "|" + LIDAR_SDK_CPUS + "|" + toString(LIDAR_LOCK_MEMORY);
+    if (lidarThreadSpec != mLidarThreadSpec)
+    {
+        mLidarThreadSpec = lidarThreadSpec;
+        LidarThreadOption threadOption;
+        threadOption.priority = LIDAR_RT_PRIORITY;
+        threadOption.roundRobin = LIDAR_RT_ROUND_ROBIN;
+        threadOption.cpuMask = parseCpuList(LIDAR_SDK_CPUS);
+        threadOption.lockMemory = LIDAR_LOCK_MEMORY;
+        // a denied setting is logged per device, realtime priority and memory locking need elevated rights
+        mFusion.setThreadOption(threadOption);
+    }
+
+    double now = getElapsedSeconds();
+    if (now - mLastStageStatsTime < 1) return;
+    mLastStageStatsTime = now;
+    PipelineStage::Stats detection = mDetectionStage.takeStats();
+    PipelineStage::Stats output = mOutputStage.takeStats();
+    mDetectionLatencyMs = detection.latencyUs / 1000;
+    mDetectionBusyMs = detection.busyUs / 1000;
+    mOutputLatencyMs = output.latencyUs / 1000;
+    mOutputMaxLatencyMs = output.maxLatencyUs / 1000;
+    mDroppedFrames = (int)(mOutputQueue.getDropCount() + mDisplayQueue.getDropCount());
+    mLogSuppressed = (int)asynclog::getSuppressedCount();
+    mLogDropped = (int)asynclog::getDroppedCount();
+
+    mPacketJitterUs = 0;
+    mPacketMaxUs = 0;
+    for (size_t d = 0; d < mFusion.getDeviceCount(); d++)
+    {
+        LidarPacketJitter jitter;
+        if (!mFusion.getPacketJitter(d, jitter) || jitter.packets == 0) continue;
+        mPacketJitterUs = std::max(mPacketJitterUs, jitter.stddevUs);
+        mPacketMaxUs = std::max(mPacketMaxUs, jitter.maxUs);
+    }
+}
+
+void MiniAreaScanApp::runDetection()
+{
+    DetectionOption option;
+    {
+        std::lock_guard<std::mutex> lock(mStageOptionMutex);
+        option = mPendingDetectionOption;
+    }
+
+    uint64_t startUs = PipelineStage::nowUs();
+    uint64_t captureUs = 0;
+    if (option.frameWidth <= 0 || !mFusion.fuse(mFusionPoints, option.fusion, &captureUs))
+    {
+        // no new scan yet, don't spin
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        return;
+    }
+
+    if (option.frameWidth != mPipeline.getWidth() || option.frameHeight != mPipeline.getHeight())
+    {
+        mPipeline.setup(option.frameWidth, option.frameHeight);
+    }
+    mPipeline.rasterize(mFusionPoints, option.pipeline);
+    mPipeline.detect(option.pipeline);
+
+    {
+        ALLOC_STAGE(STAGE_DETECTION);
+        mDetectionFrame.captureUs = captureUs;
+        mPipeline.frontMat.copyTo(mDetectionFrame.frontMat);
+        mPipeline.diffMat.copyTo(mDetectionFrame.diffMat);
+        mDetectionFrame.blobs = mPipeline.tracker.trackedBlobs;
+    }
+    mDetectionStage.addFrame(captureUs, startUs);
+    mOutputQueue.push(mDetectionFrame);
+}
+
+void MiniAreaScanApp::runOutput()
+{
+    if (!mOutputQueue.pop(mOutputFrame)) return;
+
+    uint64_t startUs = PipelineStage::nowUs();
+    {
+        std::lock_guard<std::mutex> lock(mStageOptionMutex);
+        mOutputOption = mPendingOutputOption;
+    }
+    {
+        TRACE_SCOPE("sendTuioMessage");
+        ALLOC_STAGE(STAGE_OUTPUT);
+        sendTuioMessage(*mOscSender, mOutputFrame.blobs, mOutputOption);
+    }
+    {
+        TRACE_SCOPE("publishShm");
+        ALLOC_STAGE(STAGE_OUTPUT);
+        publishShm(mOutputFrame.blobs, mOutputOption);
+    }
+    mOutputStage.addFrame(mOutputFrame.captureUs, startUs);
+#if defined(MINIAREASCAN_ALLOC_COUNTER)
+    mAllocScans++;
+#endif
+    mDisplayQueue.push(mOutputFrame);
+}
+
+void MiniAreaScanApp::recordScans()
+{
+    if (!mRecordScans) return;
+
+    size_t count = mFusion.getDeviceCount();
+    if (mScanRecorders.size() != count)
+    {
+        mScanRecorders.clear();
+        for (size_t d = 0; d < count; d++)
+        {
+            auto path = getAppPath() / ("scans-" + std::to_string(d) + ".txt");
+            mScanRecorders.push_back(make_unique<std::ofstream>(path.string()));
+            CI_LOG_I("Recording " << mDeviceSpecs[d] << " to " << path);
+        }
+        mRecordedSequences.assign(count, 0);
+    }
 
-    BlobFinder::Option option;
-    option.minArea = MIN_AREA;
-    auto blobs = BlobFinder::execute(mDiffMat, option);
-    mBlobTracker.trackBlobs(blobs);
-    sendTuioMessage(*mOscSender, mBlobTracker);
+    for (size_t d = 0; d < count; d++)
+    {
+        uint64_t sequence = 0;
+        if (!mFusion.copyLatestScan(d, mRecordedScan, &sequence) || sequence == mRecordedSequences[d]) continue;
+        // scans that arrive between two frames are skipped, the replay runs at 10 Hz anyway
+        mRecordedSequences[d] = sequence;
+        ReplayLidarDevice::writeScan(*mScanRecorders[d], mRecordedScan);
+    }
 }
@@ -68,6 +68,12 @@ public:
     //Turn off lidar connection
     void disconnecting(); //!< Closes the comms with the laser. Shouldn't have to be directly needed by the user
 
+    /** Scheduling of the scan data thread, kept across reconnects. Returns false if a setting was denied */
+    bool setThreadScheduling(int priority, bool roundRobin, uint64_t cpuMask, bool lockMemory);
+
+    /** Package arrival statistics since the previous call, false without a driver */
+    bool getPackageJitter(package_jitter &jitter);
+
 protected:
     /** Returns true if communication has been established with the device. If it's not,
       *  try to create a comms channel.
@@ -85,12 +91,29 @@ protected:
       */
     bool checkHardware();
 
+    /** Rebuilds m_IgnoreTable from m_IgnoreArray */
+    void compileIgnoreTable();
+
+    /** Creates m_driver with the thread scheduling applied */
+    bool createDriver();
+
 
 
 private:
+    ydlidar::YDlidarDriver *m_driver;
+    std::vector<float> m_CompiledIgnoreArray;
+    std::vector<uint8_t> m_IgnoreTable;
     bool isScanning;
     int node_counts ;
     double each_angle;
     int show_error;
+    int m_threadPriority;
+    bool m_threadRoundRobin;
+    uint64_t m_threadCpuMask;
+    bool m_lockMemory;
+
+    // doProcessSimple() buffers, kept so that a scan does not allocate
+    std::vector<node_info> m_nodes;
+    std::vector<node_info> m_compensateNodes;
 };	// End of class
 
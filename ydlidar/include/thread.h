@@ -8,6 +8,8 @@
 #include <process.h>
 #else
 #include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
 #include <assert.h>
 #endif
 
@@ -93,6 +95,57 @@ public:
 		return 0;
 	}
 
+	/// priority > 0 selects SCHED_FIFO (SCHED_RR with roundRobin) at that level,
+	/// clamped to the range of the policy; 0 goes back to normal scheduling
+	int setRealtime(int priority, bool roundRobin = false){
+		if (!this->_handle){ 
+			return -1;
+		}
+#if defined(_WIN32)
+		UNUSED(roundRobin);
+		int win_priority = priority >= 50 ? THREAD_PRIORITY_TIME_CRITICAL : (priority > 0 ? THREAD_PRIORITY_HIGHEST : THREAD_PRIORITY_NORMAL);
+		return SetThreadPriority(reinterpret_cast<HANDLE>(this->_handle), win_priority) ? 0 : -2;
+#else
+		struct sched_param param;
+		int policy = SCHED_OTHER;
+		param.sched_priority = 0;
+		if (priority > 0){
+			policy = roundRobin ? SCHED_RR : SCHED_FIFO;
+			int priority_max = sched_get_priority_max(policy);
+			int priority_min = sched_get_priority_min(policy);
+			param.sched_priority = priority < priority_min ? priority_min : (priority > priority_max ? priority_max : priority);
+		}
+		return pthread_setschedparam((pthread_t)this->_handle, policy, &param) == 0 ? 0 : -2;
+#endif
+	}
+
+	/// bit n of cpuMask allows cpu n, 0 allows all of them
+	int setAffinity(uint64_t cpuMask){
+		if (!this->_handle){ 
+			return -1;
+		}
+#if defined(_WIN32)
+		DWORD_PTR process_mask, system_mask;
+		if (!GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask)){
+			return -2;
+		}
+		DWORD_PTR mask = cpuMask ? (DWORD_PTR)cpuMask & process_mask : process_mask;
+		return mask && SetThreadAffinityMask(reinterpret_cast<HANDLE>(this->_handle), mask) ? 0 : -2;
+#elif defined(__linux__)
+		long cpu_count = sysconf(_SC_NPROCESSORS_CONF);
+		cpu_set_t cpus;
+		CPU_ZERO(&cpus);
+		for (long cpu = 0; cpu < cpu_count && cpu < CPU_SETSIZE; ++cpu){
+			if (!cpuMask || (cpu < 64 && (cpuMask & ((uint64_t)1 << cpu)))){
+				CPU_SET(cpu, &cpus);
+			}
+		}
+		return pthread_setaffinity_np((pthread_t)this->_handle, sizeof(cpus), &cpus) == 0 ? 0 : -2;
+#else
+		return cpuMask ? -2 : 0;
+#endif
+	}
+
 	bool operator== ( const Thread & right) { 
 		return this->_handle == right._handle; 
 	}
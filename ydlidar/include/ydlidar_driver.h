@@ -210,6 +210,14 @@ struct LaserScan {
 	LaserConfig config;
 };
 
+//! Arrival statistics of the measurement packages
+struct package_jitter {
+	uint32_t package_count;		///< packages received since the previous call
+	float mean_us;				///< mean interval between two packages
+	float stddev_us;			///< standard deviation of that interval
+	float max_us;				///< longest interval
+};
+
 using namespace std;
 using namespace serial;
 
@@ -231,6 +239,31 @@ namespace ydlidar{
 			}
 		}
 
+		// independent instances, for running several lidars in one process
+		static YDlidarDriver* create(){
+			return new YDlidarDriver;
+		}
+		static void dispose(YDlidarDriver* drv){
+			delete drv;
+		}
+
+		/**
+		* @brief Sets the scheduling of the scan data thread \n
+		* The settings are kept for every thread started later on and applied to the running one.
+		* @param[in] priority    SCHED_FIFO priority (1-99), 0 keeps the normal scheduling
+		* @param[in] roundRobin  SCHED_RR instead of SCHED_FIFO
+		* @param[in] cpuMask     CPUs the thread may run on, bit n for cpu n, 0 for all of them
+		* @param[in] lockMemory  locks the scan buffers of the driver into RAM
+		* @retval RESULT_OK      success
+		* @retval RESULT_FAIL    a setting was denied, realtime priorities usually need elevated rights
+		*/
+		result_t setCacheThreadScheduling(int priority, bool roundRobin, uint64_t cpuMask, bool lockMemory);
+
+		/**
+		* @brief Returns the package arrival statistics since the previous call and starts over \n
+		*/
+		void getPackageJitter(package_jitter &jitter);
+
 		/**
 		* @brief 连接雷达 \n
     	* 连接成功后，必须使用::disconnect函数关闭
@@ -739,6 +772,23 @@ namespace ydlidar{
     	*/
 		void disableDataGrabbing();
 
+		/**
+		* @brief Applies the thread settings to the scan data thread \n
+		* @param[in] affinity  applies the cpu mask
+		* @param[in] priority  applies the priority
+		*/
+		result_t scheduleThread(bool affinity, bool priority);
+
+		/**
+		* @brief Adds the arrival of a package to the jitter statistics \n
+		*/
+		void recordPackage();
+
+		/**
+		* @brief Adds the packages of the scan to the jitter statistics \n
+		*/
+		void publishPackages();
+
 		/**
 		* @brief 设置串口DTR \n
     	*/
@@ -807,6 +857,24 @@ namespace ydlidar{
         bool CheckSunResult;
         uint16_t Valu8Tou16;
 
+        int m_threadPriority;				///< scan data thread priority
+        bool m_threadRoundRobin;			///< SCHED_RR instead of SCHED_FIFO
+        uint64_t m_threadCpuMask;			///< scan data thread affinity
+        bool m_memoryLocked;				///< driver object locked into RAM
+
+        struct PackageStats {
+            uint32_t count;
+            double sumUs;
+            double sumSqUs;
+            uint64_t maxUs;
+        };
+        uint64_t m_packageLastUs;			///< scan data thread only
+        PackageStats m_packagePending;		///< scan data thread only, published once per scan
+        Locker m_packageLock;				///< guards m_packageStats
+        PackageStats m_packageStats;
+
+        std::vector<node_info> m_ascendBuffer;	///< ascendScanData() scratch, kept between scans
+
 	};
 }
 
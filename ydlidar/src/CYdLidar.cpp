@@ -35,6 +35,38 @@ CYdLidar::CYdLidar()
     each_angle = 0.5;
     show_error = 0;
     m_IgnoreArray.clear();
+    m_driver = NULL;
+    m_threadPriority = 0;
+    m_threadRoundRobin = false;
+    m_threadCpuMask = 0;
+    m_lockMemory = false;
+}
+
+/*-------------------------------------------------------------
+                    compileIgnoreTable
+-------------------------------------------------------------*/
+void CYdLidar::compileIgnoreTable()
+{
+    // one entry per raw q6 angle, so doProcessSimple() does a lookup instead of
+    // scanning the ignore ranges for every node
+    m_IgnoreTable.assign(1 << (16 - LIDAR_RESP_MEASUREMENT_ANGLE_SHIFT), 0);
+    for (size_t q6 = 0; q6 < m_IgnoreTable.size(); q6++) {
+        float angle = q6 / 64.0f;
+        if (angle > 180) {
+            angle = 360 - angle;
+        }
+        else {
+            angle = -angle;
+        }
+
+        for (size_t j = 0; j + 1 < m_IgnoreArray.size(); j = j + 2) {
+            if ((m_IgnoreArray[j] < angle) && (angle <= m_IgnoreArray[j + 1])) {
+                m_IgnoreTable[q6] = 1;
+                break;
+            }
+        }
+    }
+    m_CompiledIgnoreArray = m_IgnoreArray;
 }
 
 /*-------------------------------------------------------------
@@ -47,10 +79,43 @@ CYdLidar::~CYdLidar()
 
 void CYdLidar::disconnecting()
 {
-    if (YDlidarDriver::singleton()) {
-        YDlidarDriver::singleton()->disconnect();
-        YDlidarDriver::done();
+    if (m_driver) {
+        m_driver->disconnect();
+        YDlidarDriver::dispose(m_driver);
+        m_driver = NULL;
+    }
+}
+
+/*-------------------------------------------------------------
+                    setThreadScheduling
+-------------------------------------------------------------*/
+bool CYdLidar::setThreadScheduling(int priority, bool roundRobin, uint64_t cpuMask, bool lockMemory)
+{
+    m_threadPriority = priority;
+    m_threadRoundRobin = roundRobin;
+    m_threadCpuMask = cpuMask;
+    m_lockMemory = lockMemory;
+    if (!m_driver) return true;
+    return m_driver->setCacheThreadScheduling(priority, roundRobin, cpuMask, lockMemory) == RESULT_OK;
+}
+
+bool CYdLidar::getPackageJitter(package_jitter &jitter)
+{
+    if (!m_driver) return false;
+    m_driver->getPackageJitter(jitter);
+    return true;
+}
+
+bool CYdLidar::createDriver()
+{
+    m_driver = YDlidarDriver::create();
+    if (!m_driver) return false;
+    if (m_threadPriority != 0 || m_threadCpuMask != 0 || m_lockMemory) {
+        if (m_driver->setCacheThreadScheduling(m_threadPriority, m_threadRoundRobin, m_threadCpuMask, m_lockMemory) != RESULT_OK) {
+            fprintf(stderr, "[CYdLidar] Warning, the scan thread scheduling was denied\n");
+        }
     }
+    return true;
 }
 
 /*-------------------------------------------------------------
@@ -66,20 +131,21 @@ bool  CYdLidar::doProcessSimple(LaserScan &outscan, bool &hardwareError) {
         return false;
     }
 
-    vector<node_info> nodes(node_counts);
+    vector<node_info> &nodes = m_nodes;
+    nodes.resize(node_counts);
     size_t   count = node_counts;
 
     size_t all_nodes_counts = node_counts;
 
     //  wait Scan data:
     uint64_t tim_scan_start = getTime();
-    result_t op_result = YDlidarDriver::singleton()->grabScanData(nodes.data(), count);
+    result_t op_result = m_driver->grabScanData(nodes.data(), count);
     const uint64_t tim_scan_end = getTime();
 
     // Fill in scan data:
     if (op_result == RESULT_OK)
     {
-        op_result = YDlidarDriver::singleton()->ascendScanData(nodes.data(), count);
+        op_result = m_driver->ascendScanData(nodes.data(), count);
         //同步后的时间
         if (nodes[0].stamp > 0) {
             tim_scan_start = nodes[0].stamp;
@@ -92,7 +158,8 @@ bool  CYdLidar::doProcessSimple(LaserScan &outscan, bool &hardwareError) {
             }
             each_angle = 360.0 / all_nodes_counts;
 
-            vector<node_info> angle_compensate_nodes(all_nodes_counts);
+            vector<node_info> &angle_compensate_nodes = m_compensateNodes;
+            angle_compensate_nodes.resize(all_nodes_counts);
             memset(angle_compensate_nodes.data(), 0, all_nodes_counts * sizeof(node_info));
             unsigned int i = 0;
             for (; i < count; i++) {
@@ -117,7 +184,8 @@ bool  CYdLidar::doProcessSimple(LaserScan &outscan, bool &hardwareError) {
                 }
             }
 
-            LaserScan scan_msg;
+            // filled in place, assign() keeps the capacity of the caller's vectors
+            LaserScan &scan_msg = outscan;
 
             if (m_MaxAngle < m_MinAngle) {
                 float temp = m_MinAngle;
@@ -130,13 +198,17 @@ bool  CYdLidar::doProcessSimple(LaserScan &outscan, bool &hardwareError) {
             int angle_start = 180 + m_MinAngle;
             int node_start = all_nodes_counts*(angle_start / 360.0f);
 
-            scan_msg.angles.resize(counts);
-            scan_msg.ranges.resize(counts);
-            scan_msg.intensities.resize(counts);
+            scan_msg.angles.assign(counts, 0.0f);
+            scan_msg.ranges.assign(counts, 0.0f);
+            scan_msg.intensities.assign(counts, 0.0f);
             float range = 0.0;
             float intensity = 0.0;
             int index = 0;
 
+            if (m_IgnoreArray.size() != 0 && m_IgnoreArray != m_CompiledIgnoreArray) {
+                compileIgnoreTable();
+            }
+
 
             for (size_t i = 0; i < all_nodes_counts; i++) {
                 range = (float)angle_compensate_nodes[i].distance_q2 / 4.0f / 1000;
@@ -158,11 +230,8 @@ bool  CYdLidar::doProcessSimple(LaserScan &outscan, bool &hardwareError) {
                         angle = -angle;
                     }
 
-                    for (uint16_t j = 0; j < m_IgnoreArray.size(); j = j + 2) {
-                        if ((m_IgnoreArray[j] < angle) && (angle <= m_IgnoreArray[j + 1])) {
-                            range = 0.0;
-                            break;
-                        }
+                    if (m_IgnoreTable[angle_compensate_nodes[i].angle_q6_checkbit >> LIDAR_RESP_MEASUREMENT_ANGLE_SHIFT]) {
+                        range = 0.0;
                     }
                 }
 
@@ -187,7 +256,6 @@ bool  CYdLidar::doProcessSimple(LaserScan &outscan, bool &hardwareError) {
             scan_msg.config.scan_time = scan_time;
             scan_msg.config.min_angle = m_MinRange;
             scan_msg.config.max_range = m_MaxRange;
-            outscan = scan_msg;
             return true;
 
 
@@ -213,7 +281,7 @@ bool  CYdLidar::turnOn()
 {
     bool ret = false;
     if (isScanning) {
-        YDlidarDriver::singleton()->startMotor();
+        m_driver->startMotor();
         ret = true;
     }
 
@@ -225,9 +293,9 @@ bool  CYdLidar::turnOn()
 -------------------------------------------------------------*/
 bool  CYdLidar::turnOff()
 {
-    if (YDlidarDriver::singleton()) {
-        YDlidarDriver::singleton()->stop();
-        YDlidarDriver::singleton()->stopMotor();
+    if (m_driver) {
+        m_driver->stop();
+        m_driver->stopMotor();
         isScanning = false;
     }
     return true;
@@ -235,12 +303,12 @@ bool  CYdLidar::turnOff()
 
 /** Returns true if the device is connected & operative */
 bool CYdLidar::getDeviceHealth() const {
-    if (!YDlidarDriver::singleton()) return false;
+    if (!m_driver) return false;
 
     result_t op_result;
     device_health healthinfo;
 
-    op_result = YDlidarDriver::singleton()->getHealth(healthinfo);
+    op_result = m_driver->getHealth(healthinfo);
     if (op_result == RESULT_OK) {
         printf("Yd Lidar running correctly ! The health status: %s\n", (int)healthinfo.status == 0 ? "good" : "bad");
 
@@ -264,10 +332,10 @@ bool CYdLidar::getDeviceHealth() const {
 
 bool CYdLidar::getDeviceInfo(int &type) {
 
-    if (!YDlidarDriver::singleton()) return false;
+    if (!m_driver) return false;
 
     device_info devinfo;
-    if (YDlidarDriver::singleton()->getDeviceInfo(devinfo) != RESULT_OK) {
+    if (m_driver->getDeviceInfo(devinfo) != RESULT_OK) {
         if (show_error == 3)
             fprintf(stderr, "get DeviceInfo Error\n");
         return false;
@@ -295,7 +363,7 @@ bool CYdLidar::getDeviceInfo(int &type) {
     case 5:
     {
         model = "G4";
-        ans = YDlidarDriver::singleton()->getSamplingRate(_rate);
+        ans = m_driver->getSamplingRate(_rate);
         if (ans == RESULT_OK) {
             switch (m_SampleRate) {
             case 4:
@@ -313,7 +381,7 @@ bool CYdLidar::getDeviceInfo(int &type) {
             }
 
             while (_samp_rate != _rate.rate) {
-                ans = YDlidarDriver::singleton()->setSamplingRate(_rate);
+                ans = m_driver->setSamplingRate(_rate);
                 if (ans != RESULT_OK) {
                     bad++;
                     if (bad > 5) {
@@ -348,7 +416,7 @@ bool CYdLidar::getDeviceInfo(int &type) {
     case 8:
     {
         model = "F4Pro";
-        ans = YDlidarDriver::singleton()->getSamplingRate(_rate);
+        ans = m_driver->getSamplingRate(_rate);
         if (ans == RESULT_OK) {
             switch (m_SampleRate) {
             case 4:
@@ -362,7 +430,7 @@ bool CYdLidar::getDeviceInfo(int &type) {
                 break;
             }
             while (_samp_rate != _rate.rate) {
-                ans = YDlidarDriver::singleton()->setSamplingRate(_rate);
+                ans = m_driver->setSamplingRate(_rate);
                 if (ans != RESULT_OK) {
                     bad++;
                     if (bad > 5) {
@@ -444,20 +512,20 @@ bool CYdLidar::checkScanFrequency()
     scan_frequency _scan_frequency;
     int hz = 0;
     if (5 <= m_ScanFrequency && m_ScanFrequency <= 12) {
-        result_t ans = YDlidarDriver::singleton()->getScanFrequency(_scan_frequency);
+        result_t ans = m_driver->getScanFrequency(_scan_frequency);
         if (ans == RESULT_OK) {
             freq = _scan_frequency.frequency / 100.f;
             hz = m_ScanFrequency - freq;
             if (hz > 0) {
                 while (hz != 0) {
-                    YDlidarDriver::singleton()->setScanFrequencyAdd(_scan_frequency);
+                    m_driver->setScanFrequencyAdd(_scan_frequency);
                     hz--;
                 }
                 freq = _scan_frequency.frequency / 100.0f;
             }
             else {
                 while (hz != 0) {
-                    YDlidarDriver::singleton()->setScanFrequencyDis(_scan_frequency);
+                    m_driver->setScanFrequencyDis(_scan_frequency);
                     hz++;
                 }
                 freq = _scan_frequency.frequency / 100.0f;
@@ -491,22 +559,22 @@ bool CYdLidar::checkHeartBeat() const
 {
     bool ret = false;
     scan_heart_beat beat;
-    result_t ans = YDlidarDriver::singleton()->setScanHeartbeat(beat);
+    result_t ans = m_driver->setScanHeartbeat(beat);
     if (m_HeartBeat) {
         if (beat.enable&& ans == RESULT_OK) {
-            ans = YDlidarDriver::singleton()->setScanHeartbeat(beat);
+            ans = m_driver->setScanHeartbeat(beat);
         }
         if (!beat.enable&& ans == RESULT_OK) {
-            YDlidarDriver::singleton()->setHeartBeat(true);
+            m_driver->setHeartBeat(true);
             ret = true;
         }
     }
     else {
         if (!beat.enable&& ans == RESULT_OK) {
-            ans = YDlidarDriver::singleton()->setScanHeartbeat(beat);
+            ans = m_driver->setScanHeartbeat(beat);
         }
         if (beat.enable && ans == RESULT_OK) {
-            YDlidarDriver::singleton()->setHeartBeat(false);
+            m_driver->setHeartBeat(false);
             ret = true;
         }
 
@@ -520,17 +588,16 @@ bool CYdLidar::checkHeartBeat() const
 -------------------------------------------------------------*/
 bool  CYdLidar::checkCOMMs()
 {
-    if (!YDlidarDriver::singleton()) {
-        // create the driver instance
-        YDlidarDriver::initDriver();
-        if (!YDlidarDriver::singleton()) {
+    if (!m_driver) {
+        // create the driver instance, one per CYdLidar so several lidars can run in one process
+        if (!createDriver()) {
             fprintf(stderr, "Create Driver fail\n");
             return false;
 
         }
 
     }
-    if (YDlidarDriver::singleton()->isconnected()) {
+    if (m_driver->isconnected()) {
         return true;
     }
 
@@ -544,7 +611,7 @@ bool  CYdLidar::checkCOMMs()
     }
 
     // make connection...
-    result_t op_result = YDlidarDriver::singleton()->connect(m_SerialPort.c_str(), m_SerialBaudrate);
+    result_t op_result = m_driver->connect(m_SerialPort.c_str(), m_SerialBaudrate);
     if (op_result != RESULT_OK) {
         fprintf(stderr, "[CYdLidar] Error, cannot bind to the specified serial port %s\n", m_SerialPort.c_str());
         return false;
@@ -559,9 +626,9 @@ bool  CYdLidar::checkCOMMs()
 bool CYdLidar::checkStatus()
 {
 
-    if (!YDlidarDriver::singleton())
+    if (!m_driver)
         return false;
-    if (YDlidarDriver::singleton()->isscanning())
+    if (m_driver->isscanning())
         return true;
 
     std::map<int, bool> checkmodel;
@@ -583,10 +650,9 @@ again:
                 continue;
 
             show_error++;
-            YDlidarDriver::singleton()->disconnect();
-            YDlidarDriver::done();
-            YDlidarDriver::initDriver();
-            if (!YDlidarDriver::singleton()) {
+            m_driver->disconnect();
+            YDlidarDriver::dispose(m_driver);
+            if (!createDriver()) {
                 printf("YDLIDAR Create Driver fail, exit\n");
                 return false;
             }
@@ -610,7 +676,7 @@ again:
         if (m_Intensities) {
             scan_exposure exposure;
             int cnt = 0;
-            while ((YDlidarDriver::singleton()->setLowExposure(exposure) == RESULT_OK) && (cnt < 3)) {
+            while ((m_driver->setLowExposure(exposure) == RESULT_OK) && (cnt < 3)) {
                 if (exposure.exposure != m_Exposure) {
                     printf("set EXPOSURE MODEL SUCCESS!!!\n");
                     break;
@@ -624,10 +690,10 @@ again:
         }
     }
 
-    YDlidarDriver::singleton()->setIntensities(m_Intensities);
+    m_driver->setIntensities(m_Intensities);
 
     // start scan...
-    result_t s_result = YDlidarDriver::singleton()->startScan();
+    result_t s_result = m_driver->startScan();
     if (s_result != RESULT_OK) {
         fprintf(stderr, "[CYdLidar] Error starting scanning mode: %x\n", s_result);
         isScanning = false;
@@ -16,3 +16,19 @@
 #include "timer.h"
 
 #define SDKVerision "1.3.2"
+
+// optional timeline tracing, provided by the hosting application
+#if defined(MINIAREASCAN_TRACE)
+#include "Trace.h"
+#else
+#define TRACE_SCOPE(name)
+#define TRACE_THREAD_NAME(name)
+#endif
+
+// optional non-blocking logging, provided by the hosting application
+#if defined(MINIAREASCAN_ASYNC_LOG)
+#include "AsyncLog.h"
+#define SDK_LOG_E(...) ASYNC_LOG_E(__VA_ARGS__)
+#else
+#define SDK_LOG_E(...) fprintf(stderr, __VA_ARGS__)
+#endif
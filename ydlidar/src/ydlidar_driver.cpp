@@ -9,6 +9,10 @@
 #include "common.h"
 #include "ydlidar_driver.h"
 #include <math.h>
+#include <chrono>
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#endif
 using namespace impl;
 
 namespace ydlidar {
@@ -40,6 +44,22 @@ namespace ydlidar {
         LastSampleAngleCal = 0;
         CheckSunResult = true;
         Valu8Tou16 = 0;
+
+        m_threadPriority = 0;
+        m_threadRoundRobin = false;
+        m_threadCpuMask = 0;
+        m_memoryLocked = false;
+        m_packageLastUs = 0;
+        memset(&m_packagePending, 0, sizeof(m_packagePending));
+        memset(&m_packageStats, 0, sizeof(m_packageStats));
+    }
+
+    static bool lockPages(void * addr, size_t size, bool lock) {
+#if defined(_WIN32)
+        return (lock ? VirtualLock(addr, size) : VirtualUnlock(addr, size)) != FALSE;
+#else
+        return (lock ? mlock(addr, size) : munlock(addr, size)) == 0;
+#endif
     }
 
     YDlidarDriver::~YDlidarDriver() {
@@ -58,6 +78,10 @@ namespace ydlidar {
             delete _serial;
             _serial = NULL;
         }
+
+        if (m_memoryLocked) {
+            lockPages(this, sizeof(YDlidarDriver), false);
+        }
     }
 
     result_t YDlidarDriver::connect(const char * port_path, uint32_t baudrate) {
@@ -148,6 +172,9 @@ namespace ydlidar {
             isScanning = false;
         }
         _thread.join();
+
+        m_packageLastUs = 0;
+        memset(&m_packagePending, 0, sizeof(m_packagePending));
     }
 
     const bool YDlidarDriver::isscanning() const
@@ -280,6 +307,7 @@ namespace ydlidar {
     }
 
     result_t YDlidarDriver::waitForData(size_t data_count, uint32_t timeout, size_t * returned_size) {
+        TRACE_SCOPE("ydlidar serial waitfordata");
         size_t length = 0;
         if (returned_size == NULL) {
             returned_size = (size_t *)&length;
@@ -288,6 +316,7 @@ namespace ydlidar {
     }
 
     int YDlidarDriver::cacheScanData() {
+        TRACE_THREAD_NAME("ydlidar cache");
         node_info      local_buf[128];
         size_t         count = 128;
         node_info      local_scan[MAX_SCAN_NODES];
@@ -302,7 +331,7 @@ namespace ydlidar {
         while (isScanning) {
             if ((ans = waitScanData(local_buf, count)) != RESULT_OK) {
                 if (ans != RESULT_TIMEOUT) {
-                    fprintf(stderr, "exit scanning thread!!\n");
+                    SDK_LOG_E("exit scanning thread!!\n");
                     {
                         isScanning = false;
                     }
@@ -313,11 +342,13 @@ namespace ydlidar {
             for (size_t pos = 0; pos < count; ++pos) {
                 if (local_buf[pos].sync_quality & LIDAR_RESP_MEASUREMENT_SYNCBIT) {
                     if ((local_scan[0].sync_quality & LIDAR_RESP_MEASUREMENT_SYNCBIT)) {
+                        TRACE_SCOPE("ydlidar publish scan");
                         _lock.lock();//timeout lock, wait resource copy 
                         memcpy(scan_node_buf, local_scan, scan_count * sizeof(node_info));
                         scan_node_count = scan_count;
                         _dataEvent.set();
                         _lock.unlock();
+                        publishPackages();
                     }
                     scan_count = 0;
                 }
@@ -606,6 +637,7 @@ namespace ydlidar {
 
         if (package_Sample_Index == 0) {
             m_ns = ns;
+            recordPackage();
         }
 
         (*node).stamp = m_ns - nowPackageNum*trans_delay - (nowPackageNum - 1 - package_Sample_Index)*m_pointTime;
@@ -654,6 +686,7 @@ namespace ydlidar {
 #endif
 
     result_t YDlidarDriver::grabScanData(node_info * nodebuffer, size_t & count, uint32_t timeout) {
+        TRACE_SCOPE("ydlidar grabScanData");
         switch (_dataEvent.wait(timeout)) {
         case Event::EVENT_TIMEOUT:
             count = 0;
@@ -691,7 +724,8 @@ namespace ydlidar {
 
     result_t YDlidarDriver::ascendScanData(node_info * nodebuffer, size_t count) {
         float inc_origin_angle = (float)360.0 / count;
-        node_info *tmpbuffer = new node_info[count];
+        m_ascendBuffer.resize(count);
+        node_info *tmpbuffer = m_ascendBuffer.data();
         int i = 0;
 
         for (i = 0; i < (int)count; i++) {
@@ -760,7 +794,6 @@ namespace ydlidar {
         }
 
         memcpy(nodebuffer, tmpbuffer, count * sizeof(node_info));
-        delete[] tmpbuffer;
 
         return RESULT_OK;
     }
@@ -984,9 +1017,90 @@ namespace ydlidar {
             return RESULT_FAIL;
         }
         isScanning = true;
+        // a new thread inherits the affinity of the process, only touch what was asked for
+        scheduleThread(m_threadCpuMask != 0, m_threadPriority != 0);
         return RESULT_OK;
     }
 
+    result_t YDlidarDriver::setCacheThreadScheduling(int priority, bool roundRobin, uint64_t cpuMask, bool lockMemory) {
+        result_t ans = RESULT_OK;
+        bool affinityChanged = cpuMask != m_threadCpuMask;
+        bool priorityChanged = priority != m_threadPriority || roundRobin != m_threadRoundRobin;
+        m_threadPriority = priority;
+        m_threadRoundRobin = roundRobin;
+        m_threadCpuMask = cpuMask;
+
+        if (lockMemory != m_memoryLocked) {
+            // the scan buffers live inside the driver object
+            if (lockPages(this, sizeof(YDlidarDriver), lockMemory)) {
+                m_memoryLocked = lockMemory;
+            } else {
+                ans = RESULT_FAIL;
+            }
+        }
+
+        if (isScanning && scheduleThread(affinityChanged, priorityChanged) != RESULT_OK) {
+            ans = RESULT_FAIL;
+        }
+        return ans;
+    }
+
+    result_t YDlidarDriver::scheduleThread(bool affinity, bool priority) {
+        if (_thread.getHandle() == 0) {
+            return RESULT_FAIL;
+        }
+
+        int ans = 0;
+        if (affinity) {
+            ans = _thread.setAffinity(m_threadCpuMask);
+        }
+        if (priority && _thread.setRealtime(m_threadPriority, m_threadRoundRobin) != 0) {
+            ans = -1;
+        }
+        return ans == 0 ? RESULT_OK : RESULT_FAIL;
+    }
+
+    void YDlidarDriver::recordPackage() {
+        uint64_t now = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+        if (m_packageLastUs) {
+            uint64_t interval = now - m_packageLastUs;
+            m_packagePending.count++;
+            m_packagePending.sumUs += (double)interval;
+            m_packagePending.sumSqUs += (double)interval * interval;
+            if (interval > m_packagePending.maxUs) {
+                m_packagePending.maxUs = interval;
+            }
+        }
+        m_packageLastUs = now;
+    }
+
+    void YDlidarDriver::publishPackages() {
+        ScopedLocker l(m_packageLock);
+        m_packageStats.count += m_packagePending.count;
+        m_packageStats.sumUs += m_packagePending.sumUs;
+        m_packageStats.sumSqUs += m_packagePending.sumSqUs;
+        if (m_packagePending.maxUs > m_packageStats.maxUs) {
+            m_packageStats.maxUs = m_packagePending.maxUs;
+        }
+        memset(&m_packagePending, 0, sizeof(m_packagePending));
+    }
+
+    void YDlidarDriver::getPackageJitter(package_jitter &jitter) {
+        ScopedLocker l(m_packageLock);
+        jitter.package_count = m_packageStats.count;
+        jitter.mean_us = 0;
+        jitter.stddev_us = 0;
+        jitter.max_us = (float)m_packageStats.maxUs;
+        if (m_packageStats.count) {
+            double mean = m_packageStats.sumUs / m_packageStats.count;
+            double variance = m_packageStats.sumSqUs / m_packageStats.count - mean * mean;
+            jitter.mean_us = (float)mean;
+            jitter.stddev_us = variance > 0 ? (float)sqrt(variance) : 0;
+        }
+        memset(&m_packageStats, 0, sizeof(m_packageStats));
+    }
+
     /************************************************************************/
     /*   stop scan                                                   */
     /************************************************************************/